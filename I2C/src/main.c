@@ -1,14 +1,200 @@
+#include <errno.h>
 #include <zephyr/kernel.h>
 #include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "frame.h"
 
 #define PMOD_IA_NODE DT_NODELABEL(pmod_ia)
+#define SWEEP_UART_NODE DT_CHOSEN(nanofab_sweep_uart)
 
 // AD5933 Register addresses
 #define START_FREQ_REG     0x82    // Start frequency register
 #define CTRL_REG_HB       0x80    // Control Register High Byte
 #define CTRL_REG_LB       0x81    // Control Register Low Byte
+#define FREQ_INC_REG      0x85    // Frequency increment (24 bit)
+#define NUM_INC_REG       0x88    // Number of increments (9 bit)
+#define SETTLING_REG      0x8A    // Settling time cycles
 #define STATUS_REG        0x8F    // Status Register
 #define TEMP_REG          0x92    // Temperature Register
+#define REAL_REG          0x94    // Real data
+#define IMAG_REG          0x96    // Imaginary data
+
+// Control register high byte: command in D15-D12, range in D10-D9, PGA in D8
+#define CTRL_INIT_START   0x10
+#define CTRL_START_SWEEP  0x20
+#define CTRL_INC_FREQ     0x30
+#define CTRL_MEASURE_TEMP 0x90
+#define CTRL_POWER_DOWN   0xA0
+#define CTRL_STANDBY      0xB0
+#define CTRL_RANGE_2VPP   0x00
+#define CTRL_PGA_X1       0x01
+
+#define STATUS_VALID_DATA 0x02
+#define STATUS_SWEEP_DONE 0x04
+
+// Sweep: 5 kHz to 100 kHz in 1 kHz steps on the internal 16.776 MHz clock
+#define AD5933_MCLK_HZ    16776000
+#define SWEEP_START_HZ    5000
+#define SWEEP_STEP_HZ     1000
+#define SWEEP_INCREMENTS  95
+#define SWEEP_SETTLING    15
+#define SWEEP_INTERVAL_MS 1000
+#define SWEEP_POINTS      (SWEEP_INCREMENTS + 1)
+
+// FRAME_TYPE_SWEEP payload, see frame.h
+#define SWEEP_VERSION     1
+#define SWEEP_HEADER_SIZE 22
+
+static uint8_t sweep_frame[FRAME_OVERHEAD + SWEEP_HEADER_SIZE + 4 * SWEEP_POINTS];
+
+static int write_reg(const struct i2c_dt_spec *spec, uint8_t reg, uint8_t value)
+{
+    uint8_t buf[2] = {reg, value};
+
+    return i2c_write_dt(spec, buf, sizeof(buf));
+}
+
+static int read_reg(const struct i2c_dt_spec *spec, uint8_t reg, uint8_t *value)
+{
+    return i2c_write_read_dt(spec, &reg, 1, value, 1);
+}
+
+static int write_reg24(const struct i2c_dt_spec *spec, uint8_t reg, uint32_t value)
+{
+    int ret = write_reg(spec, reg, value >> 16);
+
+    ret = ret ? ret : write_reg(spec, reg + 1, value >> 8);
+    return ret ? ret : write_reg(spec, reg + 2, value);
+}
+
+static int read_reg16(const struct i2c_dt_spec *spec, uint8_t reg, int16_t *value)
+{
+    uint8_t hi, lo;
+    int ret = read_reg(spec, reg, &hi);
+
+    ret = ret ? ret : read_reg(spec, reg + 1, &lo);
+    *value = (int16_t)((hi << 8) | lo);
+    return ret;
+}
+
+// Frequency code for the start and increment registers: f * 2^27 / (MCLK / 4)
+static uint32_t freq_code(uint32_t hz)
+{
+    return (uint32_t)(((uint64_t)hz << 29) / AD5933_MCLK_HZ);
+}
+
+static int measure_temp(const struct i2c_dt_spec *spec, int16_t *temp)
+{
+    int ret = write_reg(spec, CTRL_REG_HB, CTRL_MEASURE_TEMP);
+
+    if (ret) {
+        return ret;
+    }
+    k_msleep(1);    // Conversion takes 800 us
+    ret = read_reg16(spec, TEMP_REG, temp);
+    // 14-bit two's complement
+    *temp = (int16_t)(*temp << 2) >> 2;
+    return ret;
+}
+
+static int wait_status(const struct i2c_dt_spec *spec, uint8_t *status)
+{
+    for (int i = 0; i < 100; i++) {
+        int ret = read_reg(spec, STATUS_REG, status);
+
+        if (ret || (*status & STATUS_VALID_DATA)) {
+            return ret;
+        }
+        k_msleep(1);
+    }
+    return -ETIMEDOUT;
+}
+
+/* One sweep into the payload of sweep_frame, returns the payload length */
+static int run_sweep(const struct i2c_dt_spec *spec)
+{
+    const uint8_t ctrl = CTRL_RANGE_2VPP | CTRL_PGA_X1;
+    uint8_t *payload = &sweep_frame[FRAME_HEADER_SIZE];
+    uint8_t *point = &payload[SWEEP_HEADER_SIZE];
+    uint16_t points = 0;
+    int16_t temp = 0;
+    uint8_t status;
+    int ret;
+
+    ret = measure_temp(spec, &temp);
+    ret = ret ? ret : write_reg24(spec, START_FREQ_REG, freq_code(SWEEP_START_HZ));
+    ret = ret ? ret : write_reg24(spec, FREQ_INC_REG, freq_code(SWEEP_STEP_HZ));
+    ret = ret ? ret : write_reg(spec, NUM_INC_REG, SWEEP_INCREMENTS >> 8);
+    ret = ret ? ret : write_reg(spec, NUM_INC_REG + 1, SWEEP_INCREMENTS & 0xff);
+    ret = ret ? ret : write_reg(spec, SETTLING_REG, SWEEP_SETTLING >> 8);
+    ret = ret ? ret : write_reg(spec, SETTLING_REG + 1, SWEEP_SETTLING & 0xff);
+    ret = ret ? ret : write_reg(spec, CTRL_REG_HB, CTRL_STANDBY | ctrl);
+    ret = ret ? ret : write_reg(spec, CTRL_REG_HB, CTRL_INIT_START | ctrl);
+    if (ret) {
+        return ret;
+    }
+    k_msleep(10);   // Let the excitation settle at the start frequency
+
+    ret = write_reg(spec, CTRL_REG_HB, CTRL_START_SWEEP | ctrl);
+    while (ret == 0 && points < SWEEP_POINTS) {
+        int16_t real, imag;
+
+        ret = wait_status(spec, &status);
+        ret = ret ? ret : read_reg16(spec, REAL_REG, &real);
+        ret = ret ? ret : read_reg16(spec, IMAG_REG, &imag);
+        if (ret) {
+            break;
+        }
+
+        sys_put_le16(real, &point[4 * points]);
+        sys_put_le16(imag, &point[4 * points + 2]);
+        points++;
+
+        if (status & STATUS_SWEEP_DONE) {
+            break;
+        }
+        ret = write_reg(spec, CTRL_REG_HB, CTRL_INC_FREQ | ctrl);
+    }
+    (void)write_reg(spec, CTRL_REG_HB, CTRL_POWER_DOWN | ctrl);
+    if (ret) {
+        return ret;
+    }
+
+    payload[0] = SWEEP_VERSION;
+    payload[1] = 1;     // Range 1, 2 Vpp
+    payload[2] = 1;     // PGA x1
+    payload[3] = 0;
+    sys_put_le32(AD5933_MCLK_HZ, &payload[4]);
+    sys_put_le32(freq_code(SWEEP_START_HZ), &payload[8]);
+    sys_put_le32(freq_code(SWEEP_STEP_HZ), &payload[12]);
+    sys_put_le16(points, &payload[16]);
+    sys_put_le16(SWEEP_SETTLING, &payload[18]);
+    sys_put_le16(temp, &payload[20]);
+
+    return SWEEP_HEADER_SIZE + 4 * points;
+}
+
+/*
+ * Sweeps go out as binary frames on the nanofab,sweep-uart chosen UART,
+ * which carries nothing else; ad5933_analysis.py finds them by start byte
+ * and crc.
+ */
+static void send_sweep(const struct device *uart, uint16_t seq, size_t len)
+{
+    struct frame_header hdr = {
+        .type = FRAME_TYPE_SWEEP,
+        .seq = seq,
+        .offset = k_uptime_get_32(),
+        .len = len,
+    };
+    size_t frame_len = frame_encode(sweep_frame, &hdr);
+
+    for (size_t i = 0; i < frame_len; i++) {
+        uart_poll_out(uart, sweep_frame[i]);
+    }
+}
 
 void main(void)
 {
@@ -73,4 +259,24 @@ void main(void)
             printk("Write/Read Test FAILED - values don't match\n");
         }
     }
+
+    // Continuous sweeps for host-side calibration and fitting
+    const struct device *sweep_uart = DEVICE_DT_GET(SWEEP_UART_NODE);
+
+    if (!device_is_ready(sweep_uart)) {
+        printk("Sweep UART is not ready!\n");
+        return;
+    }
+
+    printk("Sweeping %d-%d Hz, %d points every %d ms\n", SWEEP_START_HZ,
+           SWEEP_START_HZ + SWEEP_STEP_HZ * SWEEP_INCREMENTS, SWEEP_POINTS, SWEEP_INTERVAL_MS);
+    for (uint16_t seq = 0;; seq++) {
+        ret = run_sweep(&dev_i2c);
+        if (ret < 0) {
+            printk("Sweep failed (err %d)\n", ret);
+        } else {
+            send_sweep(sweep_uart, seq, ret);
+        }
+        k_msleep(SWEEP_INTERVAL_MS);
+    }
 }
\ No newline at end of file
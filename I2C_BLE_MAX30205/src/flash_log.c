@@ -0,0 +1,312 @@
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/flash.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+#if defined(CONFIG_PARTITION_MANAGER_ENABLED)
+#include <pm_config.h>
+#endif
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+#endif
+
+#include "flash_log.h"
+#include "time_sync.h"
+#if defined(CONFIG_APP_FLASH_LOG_COMPRESS)
+#include "log_codec.h"
+#endif
+
+#define LOG_REGION_OFFSET CONFIG_APP_FLASH_LOG_OFFSET
+#define LOG_REGION_SIZE   CONFIG_APP_FLASH_LOG_SIZE
+#define RAW_RECORD_SIZE   4
+
+#if defined(CONFIG_APP_FLASH_LOG_COMPRESS)
+#define LOG_FORMAT        FLASH_LOG_FORMAT_DELTA
+#define MAX_RECORD_SIZE   LOG_CODEC_MAX_RECORD
+#define MIN_RECORD_SIZE   1
+#else
+#define LOG_FORMAT        FLASH_LOG_FORMAT_RAW
+#define MAX_RECORD_SIZE   RAW_RECORD_SIZE
+#define MIN_RECORD_SIZE   RAW_RECORD_SIZE
+#endif
+
+BUILD_ASSERT(LOG_REGION_OFFSET % FLASH_LOG_SECTOR_SIZE == 0, "log region must be sector aligned");
+BUILD_ASSERT(LOG_REGION_SIZE % FLASH_LOG_SECTOR_SIZE == 0, "log region must be whole sectors");
+
+#if defined(PM_SAMPLE_LOG_ADDRESS)
+/* Must stay clear of the DFU secondary slot that shares the device */
+BUILD_ASSERT(LOG_REGION_OFFSET == PM_SAMPLE_LOG_ADDRESS &&
+             LOG_REGION_SIZE <= PM_SAMPLE_LOG_SIZE, "log region must match pm_static.yml");
+#endif
+
+static K_MUTEX_DEFINE(log_lock);
+static const struct device *flash_dev;
+
+/* Page being filled in RAM */
+static uint8_t page[FLASH_LOG_PAGE_SIZE];
+static size_t page_used = FLASH_LOG_HEADER_SIZE;
+static uint16_t page_count;
+static uint8_t page_flags;
+static uint64_t last_us;
+#if defined(CONFIG_APP_FLASH_LOG_COMPRESS)
+static struct log_codec codec;
+#endif
+
+static uint32_t next_seq;
+static uint32_t write_off;
+static struct flash_log_stats stats;
+
+static int program_page(void)
+{
+    off_t off = LOG_REGION_OFFSET + write_off;
+    int ret;
+
+    if (write_off % FLASH_LOG_SECTOR_SIZE == 0) {
+        ret = flash_erase(flash_dev, off, FLASH_LOG_SECTOR_SIZE);
+        if (ret != 0) {
+            return ret;
+        }
+        stats.erases++;
+    }
+
+    sys_put_le16(FLASH_LOG_MAGIC, &page[0]);
+    page[2] = LOG_FORMAT;
+    page[3] = page_flags;
+    sys_put_le32(next_seq, &page[4]);
+    /* base_us at [8] was filled by the first record */
+    sys_put_le16(page_count, &page[16]);
+    sys_put_le16(crc16_ccitt(0xffff, &page[FLASH_LOG_HEADER_SIZE],
+                             page_used - FLASH_LOG_HEADER_SIZE), &page[18]);
+
+    /* Only the used part is programmed, the tail stays erased */
+    ret = flash_write(flash_dev, off, page, page_used);
+    if (ret != 0) {
+        return ret;
+    }
+
+    stats.pages++;
+    stats.bytes_programmed += page_used;
+    next_seq++;
+    write_off = (write_off + FLASH_LOG_PAGE_SIZE) % LOG_REGION_SIZE;
+    page_used = FLASH_LOG_HEADER_SIZE;
+    page_count = 0;
+
+    return 0;
+}
+
+static void start_page(uint8_t flags, uint64_t timestamp_us)
+{
+    page_flags = flags;
+    sys_put_le64(timestamp_us, &page[8]);
+    last_us = timestamp_us;
+#if defined(CONFIG_APP_FLASH_LOG_COMPRESS)
+    log_codec_reset(&codec);
+#endif
+}
+
+/* Whether the record fits the page's time base: forward by at most u16 ms */
+static bool delta_fits(uint64_t timestamp_us)
+{
+    return timestamp_us >= last_us && (timestamp_us - last_us) / 1000 <= UINT16_MAX;
+}
+
+static size_t encode_record(uint64_t timestamp_us, int16_t raw, uint8_t *out)
+{
+    uint64_t delta_ms = (timestamp_us - last_us) / 1000;
+
+    __ASSERT_NO_MSG(delta_fits(timestamp_us));
+    /* Track the time readers will reconstruct so rounding never accumulates */
+    last_us += delta_ms * 1000;
+
+#if defined(CONFIG_APP_FLASH_LOG_COMPRESS)
+    return log_codec_encode(&codec, delta_ms, raw, out);
+#else
+    sys_put_le16(delta_ms, &out[0]);
+    sys_put_le16(raw, &out[2]);
+    return RAW_RECORD_SIZE;
+#endif
+}
+
+int flash_log_append(const struct sample *sample)
+{
+    uint8_t record[MAX_RECORD_SIZE];
+    uint64_t timestamp_us;
+    uint8_t flags;
+    size_t len;
+    int ret = 0;
+
+    if (!flash_dev) {
+        return -ENODEV;
+    }
+
+    flags = time_sync_to_central(sample->timestamp_us, &timestamp_us) ?
+            FLASH_LOG_FLAG_SYNCED : 0;
+
+    k_mutex_lock(&log_lock, K_FOREVER);
+
+    /*
+     * A page never mixes node and central timestamps. A gap longer than
+     * a record's u16 ms delta (readings stopped, a disconnect, a resync)
+     * or a clock stepping back also starts a page with a fresh base_us,
+     * rather than skewing every later timestamp in this one.
+     */
+    if (page_count > 0 && (flags != page_flags || !delta_fits(timestamp_us))) {
+        ret = program_page();
+        if (ret != 0) {
+            goto out;
+        }
+    }
+
+    if (page_count == 0) {
+        start_page(flags, timestamp_us);
+    }
+
+    len = encode_record(timestamp_us, sample->raw, record);
+    if (page_used + len > FLASH_LOG_PAGE_SIZE) {
+        /* Does not fit, the record opens the next page instead */
+        ret = program_page();
+        if (ret != 0) {
+            goto out;
+        }
+        start_page(flags, timestamp_us);
+        len = encode_record(timestamp_us, sample->raw, record);
+    }
+
+    memcpy(&page[page_used], record, len);
+    page_used += len;
+    page_count++;
+    stats.samples++;
+    stats.record_bytes += len;
+    stats.raw_record_bytes += RAW_RECORD_SIZE;
+
+    if (page_used + MIN_RECORD_SIZE > FLASH_LOG_PAGE_SIZE) {
+        ret = program_page();
+    }
+
+out:
+    k_mutex_unlock(&log_lock);
+    return ret;
+}
+
+int flash_log_flush(void)
+{
+    int ret = 0;
+
+    if (!flash_dev) {
+        return -ENODEV;
+    }
+
+    k_mutex_lock(&log_lock, K_FOREVER);
+    if (page_count > 0) {
+        ret = program_page();
+    }
+    k_mutex_unlock(&log_lock);
+
+    return ret;
+}
+
+void flash_log_get_stats(struct flash_log_stats *out)
+{
+    k_mutex_lock(&log_lock, K_FOREVER);
+    *out = stats;
+    k_mutex_unlock(&log_lock);
+}
+
+int flash_log_read(uint32_t off, void *buf, size_t len)
+{
+    if (!flash_dev) {
+        return -ENODEV;
+    }
+    if (off > LOG_REGION_SIZE || len > LOG_REGION_SIZE - off) {
+        return -EINVAL;
+    }
+
+    /* No lock: a page programmed mid-read fails its crc on the host */
+    return flash_read(flash_dev, LOG_REGION_OFFSET + off, buf, len);
+}
+
+int flash_log_init(const struct device *flash)
+{
+    uint8_t header[FLASH_LOG_HEADER_SIZE];
+    bool found = false;
+    uint32_t newest_seq = 0;
+    uint32_t newest_off = 0;
+
+    if (!device_is_ready(flash)) {
+        return -ENODEV;
+    }
+
+    /* Resume after the newest page so a reboot never overwrites the log */
+    for (uint32_t off = 0; off < LOG_REGION_SIZE; off += FLASH_LOG_PAGE_SIZE) {
+        int ret = flash_read(flash, LOG_REGION_OFFSET + off, header, sizeof(header));
+
+        if (ret != 0) {
+            return ret;
+        }
+        if (sys_get_le16(&header[0]) != FLASH_LOG_MAGIC) {
+            continue;
+        }
+
+        uint32_t seq = sys_get_le32(&header[4]);
+
+        if (!found || seq > newest_seq) {
+            found = true;
+            newest_seq = seq;
+            newest_off = off;
+        }
+    }
+
+    k_mutex_lock(&log_lock, K_FOREVER);
+    if (found) {
+        next_seq = newest_seq + 1;
+        write_off = (newest_off + FLASH_LOG_PAGE_SIZE) % LOG_REGION_SIZE;
+    }
+    flash_dev = flash;
+    k_mutex_unlock(&log_lock);
+
+    printk("Flash log: next page %u at offset 0x%x\n", next_seq, write_off);
+    return 0;
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_flashlog_stats(const struct shell *sh, size_t argc, char **argv)
+{
+    struct flash_log_stats s;
+
+    flash_log_get_stats(&s);
+    shell_print(sh, "samples %u pages %u erases %u programmed %u bytes",
+                s.samples, s.pages, s.erases, s.bytes_programmed);
+    if (s.samples) {
+        shell_print(sh, "%u.%02u bytes programmed per sample",
+                    s.bytes_programmed / s.samples,
+                    (s.bytes_programmed % s.samples) * 100 / s.samples);
+    }
+    if (s.record_bytes) {
+        uint32_t ratio_x100 = (uint64_t)s.raw_record_bytes * 100 / s.record_bytes;
+
+        shell_print(sh, "records %u bytes, %u.%02u:1 against the raw format",
+                    s.record_bytes, ratio_x100 / 100, ratio_x100 % 100);
+    }
+
+    return 0;
+}
+
+static int cmd_flashlog_flush(const struct shell *sh, size_t argc, char **argv)
+{
+    int ret = flash_log_flush();
+
+    if (ret != 0) {
+        shell_error(sh, "flush failed (err %d)", ret);
+    }
+    return ret;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(flashlog_cmds,
+    SHELL_CMD(stats, NULL, "Print sample, page and erase counters", cmd_flashlog_stats),
+    SHELL_CMD(flush, NULL, "Program the partially filled page", cmd_flashlog_flush),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(flashlog, &flashlog_cmds, "External flash sample log", NULL);
+#endif /* CONFIG_SHELL */
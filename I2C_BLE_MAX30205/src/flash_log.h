@@ -0,0 +1,63 @@
+#ifndef FLASH_LOG_H_
+#define FLASH_LOG_H_
+
+#include <stdint.h>
+#include <zephyr/device.h>
+
+#include "sample_pool.h"
+
+/*
+ * Circular sample log in the external AT25SF041. Samples are packed into
+ * a RAM page and programmed one 256-byte flash page at a time; the 4 KB
+ * sector ahead of the write pointer is erased just before it is reached.
+ *
+ * Page layout, little endian:
+ *   u16 magic, u8 format, u8 flags, u32 seq, u64 base_us, u16 count, u16 crc
+ *   followed by the records, see FLASH_LOG_FORMAT_RAW/_DELTA.
+ * crc is CRC-16/CCITT over the record bytes so readers can verify pages.
+ * Delta records vary in length, so readers decode exactly count records
+ * and check the crc over the bytes those spanned.
+ */
+
+#define FLASH_LOG_PAGE_SIZE   256
+#define FLASH_LOG_SECTOR_SIZE 4096
+#define FLASH_LOG_HEADER_SIZE 20
+#define FLASH_LOG_MAGIC       0x4c54
+
+/*
+ * Raw records: u16 ms since previous sample, i16 raw value. A sample that
+ * is further from the previous one, or earlier, starts a new page.
+ */
+#define FLASH_LOG_FORMAT_RAW  1
+/*
+ * Delta records: the same fields as RAW, stored as zigzag differences to
+ * the previous record in one byte when both are small, see log_codec.h.
+ * The first record of a page is relative to zero.
+ */
+#define FLASH_LOG_FORMAT_DELTA 2
+
+/* Header flag: timestamps are on the central's clock, see time_sync.h */
+#define FLASH_LOG_FLAG_SYNCED BIT(0)
+
+struct flash_log_stats {
+    uint32_t samples;
+    uint32_t pages;
+    uint32_t erases;
+    uint32_t bytes_programmed;
+    /* Record bytes as stored and as they would be in FLASH_LOG_FORMAT_RAW */
+    uint32_t record_bytes;
+    uint32_t raw_record_bytes;
+};
+
+int flash_log_init(const struct device *flash);
+int flash_log_append(const struct sample *sample);
+
+/* Program the partially filled page, e.g. before a dump or power down */
+int flash_log_flush(void);
+
+void flash_log_get_stats(struct flash_log_stats *stats);
+
+/* Read raw log region bytes for readout, off is relative to the region */
+int flash_log_read(uint32_t off, void *buf, size_t len);
+
+#endif /* FLASH_LOG_H_ */
@@ -0,0 +1,94 @@
+#include "log_codec.h"
+
+static inline uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static size_t put_varint(uint32_t v, uint8_t *out)
+{
+    size_t n = 0;
+
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)v | 0x80;
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+static size_t get_varint(const uint8_t *in, size_t len, uint32_t *v)
+{
+    uint32_t result = 0;
+
+    for (size_t n = 0; n < len && n < 5; n++) {
+        result |= (uint32_t)(in[n] & 0x7f) << (7 * n);
+        if (!(in[n] & 0x80)) {
+            *v = result;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+size_t log_codec_encode(struct log_codec *codec, uint16_t dt_ms, int16_t raw,
+                        uint8_t out[LOG_CODEC_MAX_RECORD])
+{
+    uint32_t zdt = zigzag((int32_t)dt_ms - codec->prev_dt);
+    uint32_t zraw = zigzag((int32_t)raw - codec->prev_raw);
+    uint8_t hi = zdt < LOG_CODEC_ESCAPE ? zdt : LOG_CODEC_ESCAPE;
+    uint8_t lo = zraw < LOG_CODEC_ESCAPE ? zraw : LOG_CODEC_ESCAPE;
+    size_t n = 1;
+
+    out[0] = (hi << 4) | lo;
+    if (hi == LOG_CODEC_ESCAPE) {
+        n += put_varint(zdt, &out[n]);
+    }
+    if (lo == LOG_CODEC_ESCAPE) {
+        n += put_varint(zraw, &out[n]);
+    }
+
+    codec->prev_dt = dt_ms;
+    codec->prev_raw = raw;
+    return n;
+}
+
+size_t log_codec_decode(struct log_codec *codec, const uint8_t *in, size_t len,
+                        uint16_t *dt_ms, int16_t *raw)
+{
+    uint32_t zdt, zraw;
+    size_t n = 1;
+    size_t used;
+
+    if (len == 0) {
+        return 0;
+    }
+
+    zdt = in[0] >> 4;
+    zraw = in[0] & 0xf;
+    if (zdt == LOG_CODEC_ESCAPE) {
+        used = get_varint(&in[n], len - n, &zdt);
+        if (used == 0) {
+            return 0;
+        }
+        n += used;
+    }
+    if (zraw == LOG_CODEC_ESCAPE) {
+        used = get_varint(&in[n], len - n, &zraw);
+        if (used == 0) {
+            return 0;
+        }
+        n += used;
+    }
+
+    codec->prev_dt += unzigzag(zdt);
+    codec->prev_raw += unzigzag(zraw);
+    *dt_ms = (uint16_t)codec->prev_dt;
+    *raw = (int16_t)codec->prev_raw;
+    return n;
+}
@@ -0,0 +1,41 @@
+#ifndef LOG_CODEC_H_
+#define LOG_CODEC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Delta codec for flash log records (FLASH_LOG_FORMAT_DELTA). Each record
+ * is the change of the sample interval and the change of the raw value
+ * against the previous record, both zigzag encoded. When both fit in a
+ * nibble (0..14) the record is one byte, high nibble interval, low nibble
+ * value. A nibble of 15 means that field follows as a LEB128 varint,
+ * interval first. A steady 1 s body temperature log is one byte per sample
+ * instead of four.
+ */
+
+#define LOG_CODEC_ESCAPE     0xf
+/* Escape byte plus two 3-byte varints (zigzag of a 17-bit difference) */
+#define LOG_CODEC_MAX_RECORD 7
+
+struct log_codec {
+    int32_t prev_dt;
+    int32_t prev_raw;
+};
+
+/* Start of a page: the first record is relative to zero */
+static inline void log_codec_reset(struct log_codec *codec)
+{
+    codec->prev_dt = 0;
+    codec->prev_raw = 0;
+}
+
+/* Encode one record into out, returns its length */
+size_t log_codec_encode(struct log_codec *codec, uint16_t dt_ms, int16_t raw,
+                        uint8_t out[LOG_CODEC_MAX_RECORD]);
+
+/* Decode one record, returns bytes consumed or 0 on truncated input */
+size_t log_codec_decode(struct log_codec *codec, const uint8_t *in, size_t len,
+                        uint16_t *dt_ms, int16_t *raw);
+
+#endif /* LOG_CODEC_H_ */
@@ -0,0 +1,199 @@
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "flash_log.h"
+#include "frame.h"
+#include "log_dump.h"
+
+#define DUMP_UART_NODE  DT_CHOSEN(nanofab_dump_uart)
+#define CHUNK_SIZE      CONFIG_APP_LOG_DUMP_CHUNK
+#define REQUEST_LEN     4
+#define RX_BUF_SIZE     32
+#define RX_TIMEOUT_US   1000
+#define DUMP_STACK_SIZE 1024
+
+struct dump_request {
+    uint32_t offset;
+    uint32_t len;
+};
+
+static const struct device *const dump_uart = DEVICE_DT_GET(DUMP_UART_NODE);
+
+K_MSGQ_DEFINE(dump_request_q, sizeof(struct dump_request), 2, 4);
+static K_SEM_DEFINE(tx_done, 1, 1);
+
+/* One frame is on the wire while the other is read from flash */
+static uint8_t tx_buf[2][FRAME_OVERHEAD + CHUNK_SIZE];
+
+static uint8_t rx_buf[2][RX_BUF_SIZE];
+static uint8_t rx_next;
+static uint8_t request_buf[FRAME_OVERHEAD + REQUEST_LEN];
+static struct frame_parser parser = {
+    .buf = request_buf,
+    .size = sizeof(request_buf),
+};
+
+static void rx_start(const struct device *dev)
+{
+    parser.used = 0;
+    rx_next = 1;
+    (void)uart_rx_enable(dev, rx_buf[0], sizeof(rx_buf[0]), RX_TIMEOUT_US);
+}
+
+static void rx_bytes(const uint8_t *data, size_t len)
+{
+    struct frame_header hdr;
+    struct dump_request req;
+
+    for (size_t i = 0; i < len; i++) {
+        if (!frame_parser_feed(&parser, data[i], &hdr) ||
+            hdr.type != FRAME_TYPE_DUMP_REQUEST || hdr.len != REQUEST_LEN) {
+            continue;
+        }
+
+        req.offset = hdr.offset;
+        req.len = sys_get_le32(&request_buf[FRAME_HEADER_SIZE]);
+        /* The newest request wins, older ones are stale resumes */
+        if (k_msgq_put(&dump_request_q, &req, K_NO_WAIT) != 0) {
+            k_msgq_purge(&dump_request_q);
+            (void)k_msgq_put(&dump_request_q, &req, K_NO_WAIT);
+        }
+    }
+}
+
+static void uart_cb(const struct device *dev, struct uart_event *evt, void *user_data)
+{
+    switch (evt->type) {
+    case UART_TX_DONE:
+    case UART_TX_ABORTED:
+        k_sem_give(&tx_done);
+        break;
+    case UART_RX_RDY:
+        rx_bytes(&evt->data.rx.buf[evt->data.rx.offset], evt->data.rx.len);
+        break;
+    case UART_RX_BUF_REQUEST:
+        (void)uart_rx_buf_rsp(dev, rx_buf[rx_next], sizeof(rx_buf[0]));
+        rx_next ^= 1;
+        break;
+    case UART_RX_DISABLED:
+        // Line errors stop reception; keep listening for the next request
+        rx_start(dev);
+        break;
+    default:
+        break;
+    }
+}
+
+static int send_frame(uint8_t *buf, const struct frame_header *hdr)
+{
+    size_t len = frame_encode(buf, hdr);
+    int ret;
+
+    k_sem_take(&tx_done, K_FOREVER);
+    ret = uart_tx(dump_uart, buf, len, SYS_FOREVER_US);
+    if (ret != 0) {
+        k_sem_give(&tx_done);
+    }
+    return ret;
+}
+
+static void dump(const struct dump_request *req)
+{
+    uint32_t end = CONFIG_APP_FLASH_LOG_SIZE;
+    uint32_t off = MIN(req->offset, end);
+    uint32_t start_ms = k_uptime_get_32();
+    struct frame_header hdr;
+    uint16_t seq = 0;
+    uint8_t *buf;
+    int ret;
+
+    if (req->len != 0 && req->len < end - off) {
+        end = off + req->len;
+    }
+
+    /*
+     * Program the page still in RAM so the dump includes it. Only a dump
+     * from the start does this: a host resuming after a gap or CRC error
+     * gets the log as of its first request, instead of every retry
+     * spending a partial page and its share of erases.
+     */
+    if (req->offset == 0) {
+        (void)flash_log_flush();
+    }
+
+    while (off < end) {
+        if (k_msgq_num_used_get(&dump_request_q) > 0) {
+            printk("Log dump: superseded at 0x%x\n", off);
+            return;
+        }
+
+        /* This buffer's previous frame went out before the last send returned */
+        buf = tx_buf[seq & 1];
+        hdr.type = FRAME_TYPE_DUMP_DATA;
+        hdr.seq = seq;
+        hdr.offset = off;
+        hdr.len = MIN(CHUNK_SIZE, end - off);
+
+        ret = flash_log_read(off, &buf[FRAME_HEADER_SIZE], hdr.len);
+        if (ret != 0) {
+            hdr.type = FRAME_TYPE_ERROR;
+            hdr.len = sizeof(int32_t);
+            sys_put_le32((uint32_t)ret, &buf[FRAME_HEADER_SIZE]);
+            (void)send_frame(buf, &hdr);
+            printk("Log dump: read failed at 0x%x (err %d)\n", off, ret);
+            return;
+        }
+
+        ret = send_frame(buf, &hdr);
+        if (ret != 0) {
+            printk("Log dump: tx failed (err %d)\n", ret);
+            return;
+        }
+
+        off += hdr.len;
+        seq++;
+    }
+
+    hdr.type = FRAME_TYPE_DUMP_END;
+    hdr.seq = seq;
+    hdr.offset = off;
+    hdr.len = 0;
+    (void)send_frame(tx_buf[seq & 1], &hdr);
+
+    printk("Log dump: %u bytes from 0x%x in %u ms\n",
+           end - MIN(req->offset, end), req->offset, k_uptime_get_32() - start_ms);
+}
+
+static void log_dump_thread(void)
+{
+    struct dump_request req;
+
+    for (;;) {
+        k_msgq_get(&dump_request_q, &req, K_FOREVER);
+        dump(&req);
+    }
+}
+
+K_THREAD_DEFINE(log_dump_tid, DUMP_STACK_SIZE, log_dump_thread, NULL, NULL, NULL,
+                K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
+
+int log_dump_init(void)
+{
+    int ret;
+
+    if (!device_is_ready(dump_uart)) {
+        return -ENODEV;
+    }
+
+    ret = uart_callback_set(dump_uart, uart_cb, NULL);
+    if (ret != 0) {
+        return ret;
+    }
+
+    rx_start(dump_uart);
+    printk("Log dump: listening on %s\n", dump_uart->name);
+    return 0;
+}
@@ -0,0 +1,18 @@
+#ifndef LOG_DUMP_H_
+#define LOG_DUMP_H_
+
+/*
+ * Wired readout of the flash log over the nanofab,dump-uart chosen UART,
+ * using the async (EasyDMA on nRF) UART API. The host sends a
+ * FRAME_TYPE_DUMP_REQUEST, see frame.h; the node answers with DATA frames
+ * of CONFIG_APP_LOG_DUMP_CHUNK bytes and one END frame. The flash read of
+ * each chunk overlaps the transmission of the previous one.
+ *
+ * There are no acks. A host that misses or rejects a frame requests again
+ * from the first offset it lacks, and a new request aborts the dump in
+ * progress, so an interrupted readout resumes where it stopped.
+ */
+
+int log_dump_init(void);
+
+#endif /* LOG_DUMP_H_ */
@@ -6,25 +6,50 @@
 #include <zephyr/bluetooth/conn.h>
 #include <zephyr/bluetooth/uuid.h>
 #include <zephyr/bluetooth/gatt.h>
+#if defined(CONFIG_BOOTLOADER_MCUBOOT)
+#include <zephyr/dfu/mcuboot.h>
+#endif
+
+#include "flash_log.h"
+#include "log_dump.h"
+#include "pipeline.h"
+#include "sample_pool.h"
+#include "time_sync.h"
+#include "trace.h"
 
 // Temperature sensor definitions
 #define MAX30205_NODE DT_NODELABEL(max30205)
-#define MAX30205_TEMP_REG 0x00
-#define MAX30205_CONFIG_REG 0x01
+#define FLASH_NODE DT_NODELABEL(at25sf041)
 
 // BLE UUIDs
 #define CUSTOM_SERVICE_UUID BT_UUID_128_ENCODE(0x938a803f, 0xf6b3, 0x420b, 0xa95a, 0x10cc7b32b6db)
 #define CONTROL_CHAR_UUID BT_UUID_128_ENCODE(0xa38a803f, 0xf6b3, 0x420b, 0xa95a, 0x10cc7b32b6db)
 #define TEMP_CHAR_UUID BT_UUID_128_ENCODE(0xb38a803f, 0xf6b3, 0x420b, 0xa95a, 0x10cc7b32b6db)
+#define DIAG_CHAR_UUID BT_UUID_128_ENCODE(0xc38a803f, 0xf6b3, 0x420b, 0xa95a, 0x10cc7b32b6db)
+#define TIME_SYNC_CHAR_UUID BT_UUID_128_ENCODE(0xd38a803f, 0xf6b3, 0x420b, 0xa95a, 0x10cc7b32b6db)
 
 static struct bt_uuid_128 custom_service_uuid = BT_UUID_INIT_128(CUSTOM_SERVICE_UUID);
 static struct bt_uuid_128 control_characteristic_uuid = BT_UUID_INIT_128(CONTROL_CHAR_UUID);
 static struct bt_uuid_128 temp_characteristic_uuid = BT_UUID_INIT_128(TEMP_CHAR_UUID);
+static struct bt_uuid_128 diag_characteristic_uuid = BT_UUID_INIT_128(DIAG_CHAR_UUID);
+static struct bt_uuid_128 time_sync_characteristic_uuid = BT_UUID_INIT_128(TIME_SYNC_CHAR_UUID);
 
 static struct bt_conn *current_conn;
 static bool temp_reading_active = false;
 static struct k_work_delayable temp_work;
 
+/*
+ * With the flash log up, readings run from boot whether or not a central
+ * is connected, and the control characteristic only switches the
+ * notification stream. Without it, readings run only while streaming.
+ */
+static bool logging_active;
+
+static bool readings_wanted(void)
+{
+    return temp_reading_active || logging_active;
+}
+
 // Forward declaration of the GATT service
 extern const struct bt_gatt_service_static custom_svc;
 
@@ -43,10 +68,15 @@ static const struct i2c_dt_spec dev_i2c = I2C_DT_SPEC_GET(MAX30205_NODE);
 /* Function to initialize handles */
 static void init_handles(void)
 {
-    /* The temperature value handle is at index 3 (counting from 1) */
-    temp_value_handle = bt_gatt_attr_get_handle(&custom_svc.attrs[2]);
+    /*
+     * Attribute layout: [0] service, [1]/[2] control declaration/value,
+     * [3]/[4] temperature declaration/value, [5] CCC, [6]/[7] diagnostics,
+     * [8]/[9] time sync.
+     */
+    temp_attr = &custom_svc.attrs[4];
+    temp_value_handle = bt_gatt_attr_get_handle(temp_attr);
     /* The CCC handle is right after */
-    temp_ccc_handle = bt_gatt_attr_get_handle(&custom_svc.attrs[3]);
+    temp_ccc_handle = bt_gatt_attr_get_handle(&custom_svc.attrs[5]);
     
     printk("Temperature value handle: %u\n", temp_value_handle);
     printk("Temperature CCC handle: %u\n", temp_ccc_handle);
@@ -63,7 +93,7 @@ static void temp_ccc_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value
     if (temp_notifications_enabled) {
         // Send an initial notification to verify it works
         uint8_t test_data[2] = {0x19, 0x27};  // Example: 25.39°C
-        int err = bt_gatt_notify(NULL, &custom_svc.attrs[2], test_data, sizeof(test_data));
+        int err = bt_gatt_notify(NULL, &custom_svc.attrs[4], test_data, sizeof(test_data));
         printk("Initial test notification %s (err: %d)\n", 
                err ? "failed" : "succeeded", err);
     }
@@ -84,53 +114,147 @@ static ssize_t read_temp_cb(struct bt_conn *conn,
                             temp_buffer, sizeof(temp_buffer));
 }
 
+// Pipeline diagnostics read callback: stage histograms and thread load
+static ssize_t read_diag_cb(struct bt_conn *conn,
+                        const struct bt_gatt_attr *attr,
+                        void *buf, uint16_t len, uint16_t offset)
+{
+    static uint8_t diag_buffer[TRACE_ENCODED_MAX];
+    static size_t diag_len;
+
+    // Snapshot once per long read so the chunks are consistent
+    if (offset == 0) {
+        diag_len = trace_encode(diag_buffer, sizeof(diag_buffer));
+    }
+
+    return bt_gatt_attr_read(conn, attr, buf, len, offset,
+                            diag_buffer, diag_len);
+}
+
+// Time sync callbacks: the central writes requests and anchors, reads responses
+static ssize_t read_time_sync_cb(struct bt_conn *conn,
+                        const struct bt_gatt_attr *attr,
+                        void *buf, uint16_t len, uint16_t offset)
+{
+    static uint8_t response[TIME_SYNC_RESPONSE_LEN];
+    static size_t response_len;
+
+    // Stamp t3 once per read, a Read Blob must not see a newer one
+    if (offset == 0) {
+        response_len = time_sync_encode_response(response, sizeof(response));
+    }
+
+    return bt_gatt_attr_read(conn, attr, buf, len, offset,
+                            response, response_len);
+}
+
+static ssize_t write_time_sync_cb(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                           const void *buf, uint16_t len, uint16_t offset,
+                           uint8_t flags)
+{
+    if (offset != 0) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    }
+
+    if (time_sync_handle_write(buf, len) != 0) {
+        return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+    }
+
+    return len;
+}
+
+/*
+ * Readings wait here between acquisition and the transports. The queue
+ * holds the whole pool, so a put never fails; when the transports fall
+ * behind, the slab runs out first and readings are skipped.
+ */
+K_MSGQ_DEFINE(sample_q, sizeof(struct sample *), CONFIG_APP_SAMPLE_POOL_SIZE, 4);
+
+#define TRANSPORT_STACK_SIZE 1536
+
 // Function to read temperature
 static void read_temperature(struct k_work *work)
 {
-    if (!temp_reading_active) {
+    if (!readings_wanted()) {
         return;
     }
 
-    uint8_t temp_reg = MAX30205_TEMP_REG;
-    uint8_t temp_data[2];
+    struct sample *sample;
     int ret;
 
-    ret = i2c_write_read_dt(&dev_i2c, &temp_reg, 1, temp_data, 2);
+    sample = sample_alloc();
+    if (!sample) {
+        printk("Sample pool exhausted, skipping reading\n");
+        k_work_schedule(&temp_work, K_SECONDS(1));
+        return;
+    }
+
+    trace_span_start(&sample->span);
+    ret = pipeline_acquire(&dev_i2c, sample);
+    trace_span_mark(&sample->span, TRACE_STAGE_ACQUIRE);
     
     if (ret == 0) {
-        int16_t temp_raw = (temp_data[0] << 8) | temp_data[1];
-        float temp_c = temp_raw * 0.00390625f;
-        // Convert to int for printing (multiply by 100 to keep 2 decimal places)
-        int32_t temp_int = (int32_t)(temp_c * 100);
-        printk("Temperature: %d.%02d°C\n", temp_int / 100, temp_int % 100);
-
-        // Send notification if enabled and we have a connection
-        if (temp_notifications_enabled && temp_attr) {
-            // Convert temperature to 2-byte format
-            uint8_t temp_buffer[2];
-            temp_buffer[0] = temp_int / 100;  // Whole number part
-            temp_buffer[1] = temp_int % 100;  // Decimal part
+        pipeline_convert(sample);
+        trace_span_mark(&sample->span, TRACE_STAGE_CONVERT);
+        printk("Temperature: %d.%02d°C\n", sample->centi_c / 100, sample->centi_c % 100);
+        (void)k_msgq_put(&sample_q, &sample, K_NO_WAIT);
+    } else {
+        sample_free(sample);
+    }
+    
+    // Schedule next reading if still active
+    if (readings_wanted()) {
+        k_work_schedule(&temp_work, K_SECONDS(1));
+    }
+}
+
+// Flash log and notification for each reading, off the system workqueue
+static void transport_thread(void *p1, void *p2, void *p3)
+{
+    struct sample *sample;
+    int ret;
+
+    while (1) {
+        k_msgq_get(&sample_q, &sample, K_FOREVER);
+        // Time spent queued is not a stage, it only shows in the total
+        trace_span_skip(&sample->span);
+
+#if defined(CONFIG_APP_FLASH_LOG)
+        ret = flash_log_append(sample);
+        trace_span_mark(&sample->span, TRACE_STAGE_LOG);
+        if (ret) {
+            printk("Flash log append failed (err %d)\n", ret);
+        }
+#endif
+
+        // Send notification if streaming is on and we have a connection
+        if (temp_reading_active && temp_notifications_enabled && temp_attr) {
+            // Temperature in 2-byte format, then sync flag and timestamp
+            uint8_t temp_buffer[PIPELINE_NOTIFY_LEN];
+            size_t temp_len = pipeline_encode(sample, temp_buffer, sizeof(temp_buffer));
             
             // Debug prints
             printk("Attempting notification - Handle: %d, Data: [%02X %02X]\n", 
                    temp_value_handle, temp_buffer[0], temp_buffer[1]);
             
-            // Send notification using stored attribute
-            int err = bt_gatt_notify(NULL, temp_attr, temp_buffer, sizeof(temp_buffer));
-            if (err) {
-                printk("Failed to send notification (err %d)\n", err);
+            // Send notification using stored attribute; blocks while the TX buffers are full
+            trace_span_skip(&sample->span);
+            ret = bt_gatt_notify(NULL, temp_attr, temp_buffer, temp_len);
+            trace_span_mark(&sample->span, TRACE_STAGE_NOTIFY);
+            if (ret) {
+                printk("Failed to send notification (err %d)\n", ret);
             } else {
                 printk("Notification sent successfully\n");
             }
         }
-    }
-    
-    // Schedule next reading if still active
-    if (temp_reading_active) {
-        k_work_schedule(&temp_work, K_SECONDS(1));
+        trace_span_end(&sample->span);
+        sample_free(sample);
     }
 }
 
+K_THREAD_DEFINE(transport_tid, TRANSPORT_STACK_SIZE, transport_thread, NULL, NULL, NULL,
+                K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
+
 // Callback for handling control commands
 static ssize_t write_control(struct bt_conn *conn, const struct bt_gatt_attr *attr,
                            const void *buf, uint16_t len, uint16_t offset,
@@ -144,11 +268,14 @@ static ssize_t write_control(struct bt_conn *conn, const struct bt_gatt_attr *at
 
     if (value[0] == '1' && !temp_reading_active) {
         temp_reading_active = true;
-        k_work_schedule(&temp_work, K_NO_WAIT); // Start immediate reading
+        // Start immediate reading; while logging, the next one is at most 1 s away
+        k_work_schedule(&temp_work, K_NO_WAIT);
         printk("Temperature reading started\n");
     } else if (value[0] == '0' && temp_reading_active) {
         temp_reading_active = false;
-        k_work_cancel_delayable(&temp_work);
+        if (!logging_active) {
+            k_work_cancel_delayable(&temp_work);
+        }
         printk("Temperature reading stopped\n");
     }
     
@@ -168,6 +295,14 @@ BT_GATT_SERVICE_DEFINE(custom_svc,
                           read_temp_cb, NULL, NULL),
     BT_GATT_CCC(temp_ccc_cfg_changed,
                 BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+    BT_GATT_CHARACTERISTIC(&diag_characteristic_uuid.uuid,
+                          BT_GATT_CHRC_READ,
+                          BT_GATT_PERM_READ,
+                          read_diag_cb, NULL, NULL),
+    BT_GATT_CHARACTERISTIC(&time_sync_characteristic_uuid.uuid,
+                          BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+                          BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+                          read_time_sync_cb, write_time_sync_cb, NULL),
 );
 
 // Connection callbacks
@@ -188,9 +323,11 @@ static void disconnected(struct bt_conn *conn, uint8_t reason)
         bt_conn_unref(current_conn);
         current_conn = NULL;
     }
-    // Stop temperature reading on disconnect
+    // Stop streaming on disconnect; the flash log keeps sampling
     temp_reading_active = false;
-    k_work_cancel_delayable(&temp_work);
+    if (!logging_active) {
+        k_work_cancel_delayable(&temp_work);
+    }
 }
 
 BT_CONN_CB_DEFINE(conn_callbacks) = {
@@ -224,8 +361,28 @@ int main(void)
         return -1;
     }
 
+#if defined(CONFIG_APP_FLASH_LOG)
+    // Resume the external flash log; readings still go out over BLE without it
+    err = flash_log_init(DEVICE_DT_GET(FLASH_NODE));
+    if (err) {
+        printk("Flash log init failed (err %d)\n", err);
+    }
+    logging_active = (err == 0);
+#endif
+
+#if defined(CONFIG_APP_LOG_DUMP)
+    err = log_dump_init();
+    if (err) {
+        printk("Log dump init failed (err %d)\n", err);
+    }
+#endif
+
     // Initialize work queue for temperature readings
     k_work_init_delayable(&temp_work, read_temperature);
+    if (logging_active) {
+        // Log from boot, so readings taken with no central connected survive
+        k_work_schedule(&temp_work, K_NO_WAIT);
+    }
 
     // Initialize Bluetooth
     err = bt_enable(NULL);
@@ -235,6 +392,14 @@ int main(void)
     }
 
     printk("Bluetooth initialized\n");
+
+#if defined(CONFIG_BOOTLOADER_MCUBOOT)
+    // A test image that gets this far can take DFU again, keep it
+    if (!boot_is_img_confirmed()) {
+        err = boot_write_img_confirmed();
+        printk("Image confirm %s (err %d)\n", err ? "failed" : "succeeded", err);
+    }
+#endif
     
     // Initialize handles BEFORE starting advertising
     init_handles();
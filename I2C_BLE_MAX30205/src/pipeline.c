@@ -0,0 +1,45 @@
+#include <zephyr/sys/byteorder.h>
+
+#include "pipeline.h"
+#include "time_sync.h"
+
+int pipeline_acquire(const struct i2c_dt_spec *i2c, struct sample *sample)
+{
+    uint8_t temp_reg = MAX30205_TEMP_REG;
+    uint8_t temp_data[2];
+    int ret;
+
+    ret = i2c_write_read_dt(i2c, &temp_reg, 1, temp_data, 2);
+    if (ret != 0) {
+        return ret;
+    }
+
+    sample->timestamp_us = time_sync_local_us();
+    sample->raw = sys_get_be16(temp_data);
+    return 0;
+}
+
+void pipeline_convert(struct sample *sample)
+{
+    /*
+     * 1 LSB = 1/256 degC. Integer math truncates toward zero exactly like
+     * the old (int32_t)(raw * 0.00390625f * 100) did, without the FPU.
+     */
+    sample->centi_c = (int32_t)sample->raw * 100 / 256;
+}
+
+size_t pipeline_encode(const struct sample *sample, uint8_t *buf, size_t len)
+{
+    uint64_t timestamp_us;
+
+    if (len < PIPELINE_NOTIFY_LEN) {
+        return 0;
+    }
+
+    buf[0] = sample->centi_c / 100;  // Whole number part
+    buf[1] = sample->centi_c % 100;  // Decimal part
+    buf[2] = time_sync_to_central(sample->timestamp_us, &timestamp_us);
+    sys_put_le64(timestamp_us, &buf[3]);
+
+    return PIPELINE_NOTIFY_LEN;
+}
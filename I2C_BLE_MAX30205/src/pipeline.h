@@ -0,0 +1,30 @@
+#ifndef PIPELINE_H_
+#define PIPELINE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/drivers/i2c.h>
+
+#include "sample_pool.h"
+
+#define MAX30205_TEMP_REG 0x00
+#define MAX30205_CONFIG_REG 0x01
+
+/* Notification payload: whole degC, hundredths, synced flag, le64 timestamp */
+#define PIPELINE_NOTIFY_LEN 11
+
+/*
+ * The stages of the sensor app's sample path, split out so the native_sim benchmark
+ * in pipeline_bench runs exactly the code the sensor app ships.
+ */
+
+/* Read the MAX30205 temperature register and stamp the sample */
+int pipeline_acquire(const struct i2c_dt_spec *i2c, struct sample *sample);
+
+/* Fill centi_c from the raw register value */
+void pipeline_convert(struct sample *sample);
+
+/* Build the temperature notification, returns its length or 0 */
+size_t pipeline_encode(const struct sample *sample, uint8_t *buf, size_t len);
+
+#endif /* PIPELINE_H_ */
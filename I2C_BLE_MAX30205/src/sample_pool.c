@@ -0,0 +1,25 @@
+#include <zephyr/kernel.h>
+
+#include "sample_pool.h"
+
+K_MEM_SLAB_DEFINE_STATIC(sample_slab, sizeof(struct sample),
+                         CONFIG_APP_SAMPLE_POOL_SIZE, 8);
+
+static uint32_t next_seq;
+
+struct sample *sample_alloc(void)
+{
+    struct sample *sample;
+
+    if (k_mem_slab_alloc(&sample_slab, (void **)&sample, K_NO_WAIT) != 0) {
+        return NULL;
+    }
+
+    sample->seq = next_seq++;
+    return sample;
+}
+
+void sample_free(struct sample *sample)
+{
+    k_mem_slab_free(&sample_slab, sample);
+}
@@ -0,0 +1,27 @@
+#ifndef SAMPLE_POOL_H_
+#define SAMPLE_POOL_H_
+
+#include <stdint.h>
+
+#include "trace.h"
+
+/* One temperature reading as it moves from acquisition to the transports */
+struct sample {
+    uint64_t timestamp_us;  /* node clock at acquisition, see time_sync.h */
+    uint32_t seq;
+    int16_t raw;        /* MAX30205 register value, 1/256 degC */
+    int16_t centi_c;    /* converted value, 1/100 degC */
+    struct trace_span span; /* carried from acquisition to the last transport */
+};
+
+/*
+ * Samples come from a fixed memory slab sized by CONFIG_APP_SAMPLE_POOL_SIZE,
+ * so the sensor path never touches the heap. A sample stays allocated from
+ * acquisition until the transports are done with it, so the pool bounds
+ * how many readings can queue behind a slow flash program or a full BT TX
+ * queue. Returns NULL when exhausted.
+ */
+struct sample *sample_alloc(void);
+void sample_free(struct sample *sample);
+
+#endif /* SAMPLE_POOL_H_ */
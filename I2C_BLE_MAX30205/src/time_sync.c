@@ -0,0 +1,128 @@
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+#include "time_sync.h"
+
+/*
+ * Fastest drift a 32 kHz crystal can plausibly show against the central.
+ * An anchor further off than this is a step of the central's clock (a
+ * new central, or its clock was set), not drift.
+ */
+#define DRIFT_MAX_PPB 1000000
+/* Anchors closer together than this give a too noisy drift estimate */
+#define DRIFT_MIN_SPAN_US (10 * USEC_PER_SEC)
+
+struct anchor {
+    uint64_t node_us;
+    uint64_t central_us;
+};
+
+static struct k_spinlock lock;
+static struct anchor anchor;
+static bool anchored;
+static bool drift_valid;
+static int32_t drift_ppb;
+
+/* Last request, answered by the next read */
+static uint8_t req_seq;
+static uint64_t req_t2;
+
+uint64_t time_sync_local_us(void)
+{
+    return k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+static uint64_t extrapolate(const struct anchor *a, int32_t ppb, uint64_t local_us)
+{
+    int64_t elapsed = (int64_t)(local_us - a->node_us);
+    /* Split so elapsed * ppb cannot overflow over months of uptime */
+    int64_t correction = (elapsed / 1000) * ppb / 1000000LL +
+                         (elapsed % 1000) * ppb / 1000000000LL;
+
+    return a->central_us + elapsed + correction;
+}
+
+bool time_sync_to_central(uint64_t local_us, uint64_t *central_us)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    bool synced = anchored;
+
+    *central_us = synced ? extrapolate(&anchor, drift_ppb, local_us) : local_us;
+    k_spin_unlock(&lock, key);
+
+    return synced;
+}
+
+static void set_anchor(uint64_t node_us, uint64_t central_us)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    if (anchored) {
+        int64_t node_span = (int64_t)(node_us - anchor.node_us);
+        int64_t central_span = (int64_t)(central_us - anchor.central_us);
+        int64_t skew = central_span - node_span;
+        /* Short spans still get DRIFT_MIN_SPAN_US worth of tolerance */
+        int64_t max_skew = MAX(node_span, DRIFT_MIN_SPAN_US) /
+                           (1000000000LL / DRIFT_MAX_PPB);
+
+        if (skew > max_skew || skew < -max_skew) {
+            /* The old rate belongs to the old clock, start over */
+            drift_ppb = 0;
+            drift_valid = false;
+        } else if (node_span > DRIFT_MIN_SPAN_US) {
+            /* skew is within max_skew here, so this cannot overflow */
+            int64_t estimate = skew * 1000000LL / (node_span / 1000);
+
+            /* Light smoothing so one noisy exchange does not swing the rate */
+            drift_ppb = drift_valid ? (int32_t)((3 * (int64_t)drift_ppb + estimate) / 4)
+                                    : (int32_t)estimate;
+            drift_valid = true;
+        }
+    }
+
+    anchor.node_us = node_us;
+    anchor.central_us = central_us;
+    anchored = true;
+    k_spin_unlock(&lock, key);
+}
+
+int time_sync_handle_write(const uint8_t *buf, uint16_t len)
+{
+    uint64_t now = time_sync_local_us();
+
+    if (len == TIME_SYNC_REQUEST_LEN && buf[0] == TIME_SYNC_OP_REQUEST) {
+        /* t1 at [2] stays with the central */
+        req_seq = buf[1];
+        req_t2 = now;
+        return 0;
+    }
+
+    if (len == TIME_SYNC_ANCHOR_LEN && buf[0] == TIME_SYNC_OP_ANCHOR) {
+        uint64_t node_us = sys_get_le64(&buf[2]);
+
+        /* An anchor from the future is a protocol error, not a clock */
+        if (node_us > now) {
+            return -EINVAL;
+        }
+        set_anchor(node_us, sys_get_le64(&buf[10]));
+        return 0;
+    }
+
+    return -EINVAL;
+}
+
+size_t time_sync_encode_response(uint8_t *buf, size_t len)
+{
+    if (len < TIME_SYNC_RESPONSE_LEN) {
+        return 0;
+    }
+
+    buf[0] = req_seq;
+    buf[1] = anchored;
+    sys_put_le64(req_t2, &buf[2]);
+    sys_put_le64(time_sync_local_us(), &buf[10]);
+
+    return TIME_SYNC_RESPONSE_LEN;
+}
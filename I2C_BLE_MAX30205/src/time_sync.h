@@ -0,0 +1,50 @@
+#ifndef TIME_SYNC_H_
+#define TIME_SYNC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/*
+ * Two-way clock exchange over the time sync characteristic. The central
+ * writes a request carrying its clock (t1), the node stamps arrival (t2)
+ * and answers the following read with t2 and its send time (t3). The
+ * central keeps t1 itself and matches the response on seq; it computes
+ * the offset from its receive time (t4) and writes back
+ * an anchor pairing a node time with the matching central time. Between
+ * anchors the node extrapolates with the drift measured across anchors.
+ *
+ * All times are microseconds; central time is whatever epoch the central
+ * uses, the node only keeps the mapping. Anchors survive disconnects so
+ * readings taken offline still map onto the central's clock.
+ */
+
+#define TIME_SYNC_OP_REQUEST 0x01
+#define TIME_SYNC_OP_ANCHOR  0x02
+
+/* Request: u8 op, u8 seq, u64 t1 */
+#define TIME_SYNC_REQUEST_LEN 10
+/* Anchor: u8 op, u8 seq, u64 node_us, u64 central_us */
+#define TIME_SYNC_ANCHOR_LEN 18
+/*
+ * Response: u8 seq, u8 synced, u64 t2, u64 t3. Fits the 22 bytes one read
+ * carries at the default ATT MTU, so t3 is never split across a Read Blob.
+ */
+#define TIME_SYNC_RESPONSE_LEN 18
+
+/* Node's own monotonic clock */
+uint64_t time_sync_local_us(void);
+
+/*
+ * Map a node time to central time. Returns false and the unchanged local
+ * time when no anchor has been received yet.
+ */
+bool time_sync_to_central(uint64_t local_us, uint64_t *central_us);
+
+/* Handle a write to the characteristic; returns 0 or a negative errno */
+int time_sync_handle_write(const uint8_t *buf, uint16_t len);
+
+/* Fill the response to the last request, returns its length */
+size_t time_sync_encode_response(uint8_t *buf, size_t len);
+
+#endif /* TIME_SYNC_H_ */
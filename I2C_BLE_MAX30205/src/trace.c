@@ -0,0 +1,281 @@
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/tracing/tracing.h>
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+#endif
+
+#include "trace.h"
+
+#define TRACE_FORMAT_VERSION 1
+
+struct trace_hist {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t sum_us;
+    uint16_t buckets[TRACE_HIST_BUCKETS];
+};
+
+static struct trace_hist hist[TRACE_STAGE_COUNT];
+static struct k_spinlock hist_lock;
+
+#if defined(CONFIG_TRACING_CTF) || defined(CONFIG_SHELL)
+static const char *const stage_names[TRACE_STAGE_COUNT] = {
+    "acquire", "convert", "log", "notify", "total",
+};
+#endif
+
+static void hist_add(struct trace_hist *h, uint32_t us)
+{
+    uint32_t bucket = 0;
+    uint32_t limit = TRACE_HIST_BASE_US;
+
+    while (bucket < TRACE_HIST_BUCKETS - 1 && us >= limit) {
+        bucket++;
+        limit <<= 1;
+    }
+
+    h->count++;
+    h->sum_us += us;
+    h->min_us = MIN(h->min_us, us);
+    h->max_us = MAX(h->max_us, us);
+    if (h->buckets[bucket] != UINT16_MAX) {
+        h->buckets[bucket]++;
+    }
+}
+
+static void record(enum trace_stage stage, uint32_t cycles)
+{
+    uint32_t us = k_cyc_to_us_floor32(cycles);
+    k_spinlock_key_t key = k_spin_lock(&hist_lock);
+
+    hist_add(&hist[stage], us);
+    k_spin_unlock(&hist_lock, key);
+
+#if defined(CONFIG_TRACING_CTF)
+    sys_trace_named_event(stage_names[stage], us, 0);
+#endif
+}
+
+void trace_span_start(struct trace_span *span)
+{
+    span->start = k_cycle_get_32();
+    span->last = span->start;
+}
+
+void trace_span_mark(struct trace_span *span, enum trace_stage stage)
+{
+    uint32_t now = k_cycle_get_32();
+
+    /* Unsigned subtraction handles counter wrap */
+    record(stage, now - span->last);
+    span->last = now;
+}
+
+void trace_span_skip(struct trace_span *span)
+{
+    span->last = k_cycle_get_32();
+}
+
+void trace_span_end(struct trace_span *span)
+{
+    record(TRACE_STAGE_TOTAL, span->last - span->start);
+}
+
+#if defined(CONFIG_THREAD_RUNTIME_STATS)
+/* Threads whose CPU share is reported, matched by name prefix */
+static const char *const tracked_threads[] = {
+    "sysworkq",
+    "BT RX",
+    "BT TX",
+};
+BUILD_ASSERT(ARRAY_SIZE(tracked_threads) == 3, "TRACE_ENCODED_MAX assumes three threads");
+
+struct thread_load {
+    uint64_t base_cycles;
+    uint64_t cycles;
+};
+
+static struct thread_load loads[ARRAY_SIZE(tracked_threads)];
+static uint64_t base_total_cycles;
+
+static void collect_thread(const struct k_thread *thread, void *user_data)
+{
+    const char *name = k_thread_name_get((k_tid_t)thread);
+    k_thread_runtime_stats_t stats;
+
+    ARG_UNUSED(user_data);
+
+    if (name == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(tracked_threads); i++) {
+        if (strncmp(name, tracked_threads[i], strlen(tracked_threads[i])) == 0 &&
+            k_thread_runtime_stats_get((k_tid_t)thread, &stats) == 0) {
+            loads[i].cycles = stats.execution_cycles;
+        }
+    }
+}
+
+static uint64_t collect_loads(void)
+{
+    k_thread_runtime_stats_t all;
+
+    k_thread_foreach_unlocked(collect_thread, NULL);
+    if (k_thread_runtime_stats_all_get(&all) != 0) {
+        return 0;
+    }
+    return all.execution_cycles;
+}
+
+/* Share of CPU time since the last reset, in tenths of a percent */
+static uint16_t thread_load_permille(size_t i, uint64_t total)
+{
+    uint64_t elapsed = total - base_total_cycles;
+
+    if (elapsed == 0) {
+        return 0;
+    }
+    return (uint16_t)(((loads[i].cycles - loads[i].base_cycles) * 1000U) / elapsed);
+}
+#endif /* CONFIG_THREAD_RUNTIME_STATS */
+
+void trace_reset(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&hist_lock);
+
+    memset(hist, 0, sizeof(hist));
+    for (size_t i = 0; i < ARRAY_SIZE(hist); i++) {
+        hist[i].min_us = UINT32_MAX;
+    }
+    k_spin_unlock(&hist_lock, key);
+
+#if defined(CONFIG_THREAD_RUNTIME_STATS)
+    base_total_cycles = collect_loads();
+    for (size_t i = 0; i < ARRAY_SIZE(loads); i++) {
+        loads[i].base_cycles = loads[i].cycles;
+    }
+#endif
+}
+
+/*
+ * Layout, little endian:
+ *   u8 version, u8 stages, u8 buckets, u8 threads
+ *   per stage:  u32 count, u32 min_us, u32 max_us, u32 mean_us, u16 buckets[]
+ *   per thread: u8 index, u8 reserved, u16 load in 0.1 %
+ */
+size_t trace_encode(uint8_t *buf, size_t len)
+{
+    struct trace_hist snap[TRACE_STAGE_COUNT];
+    size_t threads = 0;
+    uint8_t *p = buf;
+
+#if defined(CONFIG_THREAD_RUNTIME_STATS)
+    uint64_t total = collect_loads();
+
+    threads = ARRAY_SIZE(tracked_threads);
+#endif
+
+    if (len < TRACE_ENCODED_MAX) {
+        return 0;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&hist_lock);
+
+    memcpy(snap, hist, sizeof(snap));
+    k_spin_unlock(&hist_lock, key);
+
+    *p++ = TRACE_FORMAT_VERSION;
+    *p++ = TRACE_STAGE_COUNT;
+    *p++ = TRACE_HIST_BUCKETS;
+    *p++ = threads;
+
+    for (size_t i = 0; i < TRACE_STAGE_COUNT; i++) {
+        const struct trace_hist *h = &snap[i];
+
+        sys_put_le32(h->count, p);
+        sys_put_le32(h->count ? h->min_us : 0, p + 4);
+        sys_put_le32(h->max_us, p + 8);
+        sys_put_le32(h->count ? (uint32_t)(h->sum_us / h->count) : 0, p + 12);
+        p += 16;
+        for (size_t b = 0; b < TRACE_HIST_BUCKETS; b++) {
+            sys_put_le16(h->buckets[b], p);
+            p += 2;
+        }
+    }
+
+#if defined(CONFIG_THREAD_RUNTIME_STATS)
+    for (size_t i = 0; i < threads; i++) {
+        p[0] = i;
+        p[1] = 0;
+        sys_put_le16(thread_load_permille(i, total), p + 2);
+        p += 4;
+    }
+#endif
+
+    return p - buf;
+}
+
+static int trace_init(void)
+{
+    trace_reset();
+    return 0;
+}
+
+SYS_INIT(trace_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+#if defined(CONFIG_SHELL)
+static int cmd_trace_show(const struct shell *sh, size_t argc, char **argv)
+{
+    struct trace_hist snap[TRACE_STAGE_COUNT];
+    k_spinlock_key_t key = k_spin_lock(&hist_lock);
+
+    memcpy(snap, hist, sizeof(snap));
+    k_spin_unlock(&hist_lock, key);
+
+    shell_print(sh, "%-8s %8s %8s %8s %8s  buckets (<%u us, x2 each)",
+                "stage", "count", "min", "mean", "max", TRACE_HIST_BASE_US);
+    for (size_t i = 0; i < TRACE_STAGE_COUNT; i++) {
+        const struct trace_hist *h = &snap[i];
+
+        shell_fprintf(sh, SHELL_NORMAL, "%-8s %8u %8u %8u %8u ",
+                      stage_names[i], h->count, h->count ? h->min_us : 0,
+                      h->count ? (uint32_t)(h->sum_us / h->count) : 0, h->max_us);
+        for (size_t b = 0; b < TRACE_HIST_BUCKETS; b++) {
+            shell_fprintf(sh, SHELL_NORMAL, " %u", h->buckets[b]);
+        }
+        shell_fprintf(sh, SHELL_NORMAL, "\n");
+    }
+
+#if defined(CONFIG_THREAD_RUNTIME_STATS)
+    uint64_t total = collect_loads();
+
+    for (size_t i = 0; i < ARRAY_SIZE(tracked_threads); i++) {
+        uint16_t load = thread_load_permille(i, total);
+
+        shell_print(sh, "thread %-8s %u.%u %%", tracked_threads[i], load / 10, load % 10);
+    }
+#endif
+
+    return 0;
+}
+
+static int cmd_trace_reset(const struct shell *sh, size_t argc, char **argv)
+{
+    trace_reset();
+    shell_print(sh, "trace statistics cleared");
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(trace_cmds,
+    SHELL_CMD(show, NULL, "Print stage latency histograms and thread load", cmd_trace_show),
+    SHELL_CMD(reset, NULL, "Clear histograms and thread load baselines", cmd_trace_reset),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(trace, &trace_cmds, "Pipeline tracing", NULL);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,67 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/kernel.h>
+
+/* Stages of the acquisition-to-notify pipeline, see read_temperature() and transport_thread() */
+enum trace_stage {
+    TRACE_STAGE_ACQUIRE,    /* I2C read of the MAX30205 */
+    TRACE_STAGE_CONVERT,    /* raw register -> centi-degrees */
+    TRACE_STAGE_LOG,        /* append to the external flash log */
+    TRACE_STAGE_NOTIFY,     /* bt_gatt_notify() */
+    TRACE_STAGE_TOTAL,      /* whole pass, first to last mark, queueing included */
+    TRACE_STAGE_COUNT,
+};
+
+/*
+ * Histogram buckets are powers of two in microseconds, starting at
+ * TRACE_HIST_BASE_US: [0,16) [16,32) ... [512,1024) [1024,inf).
+ * Microseconds rather than cycles so native_sim and hardware compare.
+ */
+#define TRACE_HIST_BUCKETS 8
+#define TRACE_HIST_BASE_US 16
+
+/* Size of the trace_encode() output: header, stages, sysworkq/BT RX/BT TX */
+#define TRACE_ENCODED_MAX (4 + TRACE_STAGE_COUNT * (16 + 2 * TRACE_HIST_BUCKETS) + 3 * 4)
+
+/* One pass through the pipeline, carried in struct sample across threads */
+struct trace_span {
+    uint32_t start;
+    uint32_t last;
+};
+
+#if defined(CONFIG_APP_PIPELINE_TRACE)
+
+void trace_span_start(struct trace_span *span);
+void trace_span_mark(struct trace_span *span, enum trace_stage stage);
+/* Restart the stage clock without recording, e.g. to leave out console output */
+void trace_span_skip(struct trace_span *span);
+void trace_span_end(struct trace_span *span);
+void trace_reset(void);
+
+/* Serialise histograms and thread stats for the diagnostics characteristic */
+size_t trace_encode(uint8_t *buf, size_t len);
+
+#else
+
+static inline void trace_span_start(struct trace_span *span) { ARG_UNUSED(span); }
+static inline void trace_span_mark(struct trace_span *span, enum trace_stage stage)
+{
+    ARG_UNUSED(span);
+    ARG_UNUSED(stage);
+}
+static inline void trace_span_skip(struct trace_span *span) { ARG_UNUSED(span); }
+static inline void trace_span_end(struct trace_span *span) { ARG_UNUSED(span); }
+static inline void trace_reset(void) {}
+static inline size_t trace_encode(uint8_t *buf, size_t len)
+{
+    ARG_UNUSED(buf);
+    ARG_UNUSED(len);
+    return 0;
+}
+
+#endif /* CONFIG_APP_PIPELINE_TRACE */
+
+#endif /* TRACE_H_ */
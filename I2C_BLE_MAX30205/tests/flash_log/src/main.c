@@ -0,0 +1,148 @@
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/ztest.h>
+
+#include "flash_log.h"
+#if defined(CONFIG_APP_FLASH_LOG_COMPRESS)
+#include "log_codec.h"
+#endif
+
+#define FLASH_NODE DT_NODELABEL(at25sf041)
+#define MAX_SAMPLES 600
+
+struct decoded {
+    uint64_t us;
+    int16_t raw;
+};
+
+static struct decoded readback[MAX_SAMPLES];
+
+/* Decode one programmed page the way log_dump_host.py does, appending to out */
+static size_t decode_page(uint32_t index, struct decoded *out, size_t max)
+{
+    uint8_t page[FLASH_LOG_PAGE_SIZE];
+    size_t pos = FLASH_LOG_HEADER_SIZE;
+    uint64_t us;
+    uint16_t count;
+#if defined(CONFIG_APP_FLASH_LOG_COMPRESS)
+    struct log_codec codec;
+
+    log_codec_reset(&codec);
+#endif
+
+    zassert_ok(flash_log_read(index * FLASH_LOG_PAGE_SIZE, page, sizeof(page)));
+    zassert_equal(sys_get_le16(&page[0]), FLASH_LOG_MAGIC, "page %u not programmed", index);
+    us = sys_get_le64(&page[8]);
+    count = sys_get_le16(&page[16]);
+    zassert_true(count <= max);
+
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t dt_ms;
+        int16_t raw;
+
+        if (page[2] == FLASH_LOG_FORMAT_RAW) {
+            dt_ms = sys_get_le16(&page[pos]);
+            raw = sys_get_le16(&page[pos + 2]);
+            pos += 4;
+        } else {
+#if defined(CONFIG_APP_FLASH_LOG_COMPRESS)
+            size_t used = log_codec_decode(&codec, &page[pos], sizeof(page) - pos,
+                                           &dt_ms, &raw);
+
+            zassert_true(used > 0, "truncated record in page %u", index);
+            pos += used;
+#else
+            zassert_unreachable("unexpected format %u", page[2]);
+#endif
+        }
+        us += (uint64_t)dt_ms * 1000;
+        out[i] = (struct decoded){ .us = us, .raw = raw };
+    }
+
+    zassert_equal(sys_get_le16(&page[18]),
+                  crc16_ccitt(0xffff, &page[FLASH_LOG_HEADER_SIZE], pos - FLASH_LOG_HEADER_SIZE));
+    return count;
+}
+
+/*
+ * Log samples at the given node times (whole ms, so they round-trip
+ * exactly), read the pages back and check every timestamp. Returns the
+ * number of pages the run took.
+ */
+static uint32_t log_and_check(const uint64_t *ms, size_t n)
+{
+    struct flash_log_stats before, after;
+    size_t decoded = 0;
+
+    zassert_true(n <= MAX_SAMPLES);
+    flash_log_get_stats(&before);
+
+    for (size_t i = 0; i < n; i++) {
+        struct sample sample = {
+            .timestamp_us = ms[i] * 1000,
+            .seq = i,
+            .raw = 37 * 256 + (int16_t)(i % 7),
+        };
+
+        zassert_ok(flash_log_append(&sample));
+    }
+    zassert_ok(flash_log_flush());
+    flash_log_get_stats(&after);
+
+    for (uint32_t page = before.pages; page < after.pages; page++) {
+        decoded += decode_page(page, &readback[decoded], MAX_SAMPLES - decoded);
+    }
+
+    zassert_equal(decoded, n, "decoded %zu of %zu samples", decoded, n);
+    for (size_t i = 0; i < n; i++) {
+        zassert_equal(readback[i].us, ms[i] * 1000, "sample %zu: %llu us, expected %llu",
+                      i, (unsigned long long)readback[i].us, (unsigned long long)ms[i] * 1000);
+        zassert_equal(readback[i].raw, 37 * 256 + (int16_t)(i % 7));
+    }
+
+    return after.pages - before.pages;
+}
+
+ZTEST(flash_log, test_gap_over_delta_range)
+{
+    /* Readings stopped for 70 s, longer than a u16 ms delta holds */
+    static const uint64_t ms[] = { 1000, 2000, 3000, 73000, 74000, 75000 };
+
+    zassert_equal(log_and_check(ms, ARRAY_SIZE(ms)), 2);
+}
+
+ZTEST(flash_log, test_gap_at_delta_limit)
+{
+    static const uint64_t fits[] = { 100000, 100000 + UINT16_MAX, 101000 + UINT16_MAX };
+    static const uint64_t over[] = { 300000, 300000 + UINT16_MAX + 1, 301000 + UINT16_MAX };
+
+    zassert_equal(log_and_check(fits, ARRAY_SIZE(fits)), 1);
+    zassert_equal(log_and_check(over, ARRAY_SIZE(over)), 2);
+}
+
+ZTEST(flash_log, test_clock_step_back)
+{
+    static const uint64_t ms[] = { 500000, 501000, 450000, 451000 };
+
+    zassert_equal(log_and_check(ms, ARRAY_SIZE(ms)), 2);
+}
+
+ZTEST(flash_log, test_steady_across_pages)
+{
+    static uint64_t ms[MAX_SAMPLES];
+
+    for (size_t i = 0; i < ARRAY_SIZE(ms); i++) {
+        ms[i] = 1000000 + i * 1000;
+    }
+    zassert_true(log_and_check(ms, ARRAY_SIZE(ms)) > 1);
+}
+
+static void *flash_log_setup(void)
+{
+    zassert_ok(flash_log_init(DEVICE_DT_GET(FLASH_NODE)));
+    return NULL;
+}
+
+ZTEST_SUITE(flash_log, NULL, flash_log_setup, NULL, NULL, NULL);
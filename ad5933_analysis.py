@@ -0,0 +1,472 @@
+#!/usr/bin/env python3
+"""Batch calibration and equivalent-circuit fitting of AD5933 sweeps.
+
+  ad5933_analysis.py fit --capture sweeps.bin --cal cal.bin --rcal 1000 --model cole --csv fits.csv
+  ad5933_analysis.py bench --sweeps 20000 --workers 4
+
+I2C/src/main.c sends each sweep as a FRAME_TYPE_SWEEP frame on uart0, see
+common/frame.h; its console is on RTT, so nothing else shares the port. A
+capture is the raw byte stream from that port, and the frame reader still
+resyncs on the start byte and crc after line noise or a partial frame.
+
+Calibration follows the datasheet: a capture on a known resistor gives
+the gain factor and system phase at every frequency point. The DFT
+measures the response current, so each calibrated point is an admittance
+and Z = 1 / (gain * (real + j imag) * exp(-j phase)).
+
+Models fitted per sweep:
+  r     Z = R                                   closed form
+  rc    Z = R / (1 + jwRC), R parallel C        linear least squares on Y
+  cole  Z = Rinf + (R0 - Rinf) / (1 + (jw tau)^alpha)
+                                                Levenberg-Marquardt
+
+All of it works on (sweeps, points) arrays. The Cole fit runs every sweep's
+iteration at once with a per-sweep damping factor, and large batches are
+split over a process pool. bench times each stage on synthetic sweeps,
+including a per-point Python loop as reference, and checks that the fit
+recovers the parameters the sweeps were made from.
+
+Requires numpy.
+"""
+
+import argparse
+import concurrent.futures
+import csv
+import io
+import math
+import os
+import struct
+import sys
+import time
+from dataclasses import dataclass
+
+import numpy as np
+
+import frame_host
+
+SWEEP_HEADER = struct.Struct("<BBBBIIIHHh")  # version, range, pga, reserved,
+                                              # mclk_hz, start_code, inc_code,
+                                              # points, settling, temp
+SWEEP_VERSION = 1
+TEMP_LSB_C = 1 / 32
+
+MODELS = {
+    "r": ("r_ohm",),
+    "rc": ("r_ohm", "c_f"),
+    "cole": ("r0_ohm", "rinf_ohm", "tau_s", "alpha"),
+}
+
+# Sweeps per task handed to a worker process
+CHUNK = 2048
+
+
+@dataclass
+class SweepBatch:
+    """Sweeps sharing one frequency grid; data is (sweeps, points) int16 pairs."""
+    freq_hz: np.ndarray
+    real: np.ndarray
+    imag: np.ndarray
+    seq: np.ndarray
+    uptime_ms: np.ndarray
+    temp_c: np.ndarray
+
+    def __len__(self):
+        return len(self.seq)
+
+
+@dataclass
+class Calibration:
+    freq_hz: np.ndarray
+    gain: np.ndarray
+    phase: np.ndarray
+
+
+def sweep_freqs(mclk_hz, start_code, inc_code, points):
+    """Frequency of each point from the register codes, f = code * (MCLK / 4) / 2^27."""
+    codes = start_code + inc_code * np.arange(points, dtype=np.float64)
+    return codes * (mclk_hz / 4) / (1 << 27)
+
+
+def read_frames(stream):
+    """[(seq, offset, payload)] of every sweep frame in a binary stream."""
+    reader = frame_host.FrameReader(stream.read)
+    frames = []
+    while True:
+        frame = reader.next()
+        if frame is None:
+            break
+        ftype, seq, offset, payload = frame
+        if ftype == frame_host.TYPE_SWEEP:
+            frames.append((seq, offset, payload))
+    if reader.crc_errors:
+        print(f"{reader.crc_errors} bad frame(s) skipped", file=sys.stderr)
+    return frames
+
+
+def decode_sweeps(frames):
+    """Stack sweep frames into a SweepBatch.
+
+    Sweeps on a different grid than the first complete one, e.g. after a
+    firmware change or a sweep cut short by an I2C error, are dropped.
+    """
+    grid = None
+    payloads = []
+    seqs, offsets, temps = [], [], []
+    for seq, offset, payload in frames:
+        if len(payload) < SWEEP_HEADER.size:
+            continue
+        version, _, _, _, mclk, start, inc, points, _, temp = SWEEP_HEADER.unpack_from(payload)
+        if version != SWEEP_VERSION or len(payload) != SWEEP_HEADER.size + 4 * points:
+            continue
+        if grid is None:
+            grid = (mclk, start, inc, points)
+        elif (mclk, start, inc, points) != grid:
+            continue
+        payloads.append(payload)
+        seqs.append(seq)
+        offsets.append(offset)
+        temps.append(temp)
+
+    if grid is None:
+        raise ValueError("no sweep frames in capture")
+    if len(payloads) < len(frames):
+        print(f"{len(frames) - len(payloads)} sweep(s) off the common grid dropped",
+              file=sys.stderr)
+
+    # One frombuffer over all payloads instead of a struct call per point
+    points = grid[3]
+    record = np.dtype([("header", f"V{SWEEP_HEADER.size}"), ("data", "<i2", (points, 2))])
+    data = np.frombuffer(b"".join(payloads), dtype=record)["data"]
+    return SweepBatch(freq_hz=sweep_freqs(*grid),
+                      real=data[:, :, 0].astype(np.float64),
+                      imag=data[:, :, 1].astype(np.float64),
+                      seq=np.asarray(seqs, dtype=np.uint16),
+                      uptime_ms=np.asarray(offsets, dtype=np.uint32),
+                      temp_c=np.asarray(temps, dtype=np.float64) * TEMP_LSB_C)
+
+
+def load_capture(path):
+    with open(path, "rb") as f:
+        return decode_sweeps(read_frames(f))
+
+
+def calibrate(cal, r_cal):
+    """Gain factor and system phase per point from sweeps on a resistor r_cal."""
+    dft = (cal.real + 1j * cal.imag).mean(axis=0)
+    return Calibration(freq_hz=cal.freq_hz,
+                       gain=1.0 / (r_cal * np.abs(dft)),
+                       phase=np.angle(dft))
+
+
+def impedance(batch, cal):
+    """Complex impedance, (sweeps, points)."""
+    if batch.freq_hz.shape != cal.freq_hz.shape or \
+            not np.allclose(batch.freq_hz, cal.freq_hz):
+        raise ValueError("calibration was taken on a different frequency grid")
+    rot = cal.gain * np.exp(-1j * cal.phase)
+    return 1.0 / ((batch.real + 1j * batch.imag) * rot)
+
+
+def impedance_loop(batch, cal):
+    """impedance() one point at a time, the reference for bench."""
+    out = np.empty(batch.real.shape, dtype=np.complex128)
+    for i in range(batch.real.shape[0]):
+        for k in range(batch.real.shape[1]):
+            re, im = batch.real[i, k], batch.imag[i, k]
+            mag = 1.0 / (cal.gain[k] * math.hypot(re, im))
+            theta = cal.phase[k] - math.atan2(im, re)
+            out[i, k] = complex(mag * math.cos(theta), mag * math.sin(theta))
+    return out
+
+
+def fit_r(freq_hz, z):
+    return {"r_ohm": z.real.mean(axis=1),
+            "rmse": _rel_rmse(z, z.real.mean(axis=1, keepdims=True))}
+
+
+def fit_rc(freq_hz, z):
+    """R parallel C: Y = 1/R + jwC is linear in both."""
+    w = 2 * np.pi * freq_hz
+    y = 1.0 / z
+    g = y.real.mean(axis=1)
+    c = (y.imag @ w) / (w @ w)
+    model = 1.0 / (g[:, None] + 1j * w * c[:, None])
+    return {"r_ohm": 1.0 / g, "c_f": c, "rmse": _rel_rmse(z, model)}
+
+
+def _cole(w, p, jacobian=True):
+    """Model and Jacobian for p = (rinf, dr, log tau, alpha), each (sweeps,)."""
+    rinf, dr, log_tau, alpha = (p[:, i, None] for i in range(4))
+    # (jw tau)^alpha in polar form, cheaper than a complex power
+    log_wt = np.log(w) + log_tau            # (sweeps, points)
+    u = np.exp(alpha * log_wt) * np.exp(0.5j * np.pi * alpha)
+    den = 1.0 / (1.0 + u)
+    z = rinf + dr * den
+    if not jacobian:
+        return z
+    d = -dr * u * den * den
+    jac = np.empty(z.shape + (4,), dtype=z.dtype)
+    jac[..., 0] = 1.0
+    jac[..., 1] = den
+    jac[..., 2] = d * alpha
+    jac[..., 3] = d * (log_wt + 0.5j * np.pi)
+    return z, jac
+
+
+def _cole_start(w, z):
+    r0 = z.real[:, 0]
+    rinf = np.minimum(z.real[:, -1], 0.9 * r0)
+    peak = np.argmin(z.imag, axis=1)
+    return np.stack([rinf, r0 - rinf, -np.log(w[peak]), np.full_like(r0, 0.8)], axis=1)
+
+
+def fit_cole(freq_hz, z, iterations=50, tol=1e-8):
+    """Batched Levenberg-Marquardt on residuals relative to |Z|.
+
+    Each iteration works on the sweeps that have not converged yet, so a
+    batch costs about as much as its slowest sweeps.
+    """
+    w = 2 * np.pi * freq_hz
+    scale = 1.0 / np.abs(z)
+    p = _cole_start(w, z)
+    lam = np.full(len(z), 1e-2)
+    diag = np.arange(4)
+
+    def residual(model, rows):
+        r = (model - z[rows]) * scale[rows]
+        return np.concatenate([r.real, r.imag], axis=1)
+
+    def real_jac(jac, rows):
+        jac = jac * scale[rows, :, None]
+        return np.concatenate([jac.real, jac.imag], axis=1)   # (sweeps, 2 points, 4)
+
+    active = np.arange(len(z))
+    model, jac = _cole(w, p)
+    r = residual(model, active)
+    jr = real_jac(jac, active)
+    sse = np.einsum("ij,ij->i", r, r)
+
+    for _ in range(iterations):
+        if not len(active):
+            break
+        jrt = jr.transpose(0, 2, 1)
+        jtj = jrt @ jr
+        jtr = (jrt @ r[:, :, None])[:, :, 0]
+        jtj[:, diag, diag] *= 1.0 + lam[active, None]
+        jtj[:, diag, diag] += 1e-12
+        step = np.linalg.solve(jtj, -jtr[:, :, None])[:, :, 0]
+
+        trial = p[active] + step
+        trial[:, 3] = np.clip(trial[:, 3], 0.05, 1.0)
+        r_new = residual(_cole(w, trial, jacobian=False), active)
+        sse_old = sse[active]
+        sse_new = np.einsum("ij,ij->i", r_new, r_new)
+
+        # Keep the step where it helped, raise the damping where it did not
+        better = np.isfinite(sse_new) & (sse_new < sse_old)
+        done = (better & (sse_old - sse_new <= tol * sse_old)) | (lam[active] > 1e8)
+        moved = active[better]
+        p[moved] = trial[better]
+        sse[moved] = sse_new[better]
+        lam[active] = np.where(better, lam[active] / 3, lam[active] * 4)
+
+        keep = ~done
+        active = active[keep]
+        r = np.where(better[:, None], r_new, r)[keep]
+        jr = jr[keep]
+        update = better[keep]
+        if update.any():
+            rows = active[update]
+            jr[update] = real_jac(_cole(w, p[rows])[1], rows)
+
+    rmse = np.sqrt(sse / (2 * len(w)))
+    return {"r0_ohm": p[:, 0] + p[:, 1], "rinf_ohm": p[:, 0], "tau_s": np.exp(p[:, 2]),
+            "alpha": p[:, 3], "rmse": rmse}
+
+
+FITS = {"r": fit_r, "rc": fit_rc, "cole": fit_cole}
+
+
+def _rel_rmse(z, model):
+    r = np.abs(model - z) / np.abs(z)
+    return np.sqrt((r * r).mean(axis=1))
+
+
+def _fit_chunk(args):
+    model, freq_hz, z = args
+    return FITS[model](freq_hz, z)
+
+
+def fit(freq_hz, z, model, workers=1):
+    """Fit every row of z; more than one worker splits the rows over processes.
+
+    Only the iterative Cole fit is worth a pool, the closed forms finish
+    faster than the batch can be pickled to a worker.
+    """
+    if model != "cole" or workers <= 1 or len(z) <= CHUNK:
+        return FITS[model](freq_hz, z)
+
+    chunks = np.array_split(z, math.ceil(len(z) / CHUNK))
+    with concurrent.futures.ProcessPoolExecutor(workers) as pool:
+        parts = list(pool.map(_fit_chunk, [(model, freq_hz, c) for c in chunks]))
+    return {key: np.concatenate([part[key] for part in parts]) for key in parts[0]}
+
+
+def write_csv(out, batch, result, model):
+    columns = MODELS[model] + ("rmse",)
+    writer = csv.writer(out)
+    writer.writerow(("seq", "uptime_ms", "temp_c") + columns)
+    for i in range(len(batch)):
+        writer.writerow([int(batch.seq[i]), int(batch.uptime_ms[i]), f"{batch.temp_c[i]:.2f}"] +
+                        [f"{result[c][i]:.6g}" for c in columns])
+
+
+def cmd_fit(args):
+    batch = load_capture(args.capture)
+    cal = calibrate(load_capture(args.cal), args.rcal)
+    print(f"{len(batch)} sweeps, {len(batch.freq_hz)} points "
+          f"{batch.freq_hz[0]:.0f}-{batch.freq_hz[-1]:.0f} Hz", file=sys.stderr)
+
+    start = time.perf_counter()
+    result = fit(batch.freq_hz, impedance(batch, cal), args.model, args.workers)
+    elapsed = time.perf_counter() - start
+    print(f"{args.model} fit in {elapsed * 1000:.0f} ms, "
+          f"median rmse {np.median(result['rmse']) * 100:.2f} %", file=sys.stderr)
+
+    if args.csv:
+        with open(args.csv, "w", newline="", encoding="utf-8") as f:
+            write_csv(f, batch, result, args.model)
+    else:
+        write_csv(sys.stdout, batch, result, args.model)
+
+
+# Synthetic sweeps for bench
+
+# A gain and system phase typical of range 1, PGA x1 with a 1 kOhm feedback resistor
+SYNTH_DFT_GAIN = 1.2e7
+SYNTH_SYSTEM_PHASE = (0.2, 0.5)   # rad, linear over the sweep
+# The grid I2C/src/main.c sweeps
+SYNTH_GRID = (16776000, 5000, 1000, 96)
+
+
+def synth_grid():
+    mclk, start_hz, step_hz, points = SYNTH_GRID
+    code = lambda hz: (hz << 29) // mclk   # noqa: E731 - mirrors freq_code()
+    return mclk, code(start_hz), code(step_hz), points
+
+
+def synth_frames(z, noise, rng):
+    """Encode impedances as the firmware would: int16 DFT codes in sweep frames."""
+    mclk, start, inc, points = synth_grid()
+    phase = np.linspace(*SYNTH_SYSTEM_PHASE, points)
+    dft = SYNTH_DFT_GAIN / z * np.exp(1j * phase)
+    dft += rng.normal(scale=noise, size=dft.shape) + 1j * rng.normal(scale=noise, size=dft.shape)
+    codes = np.empty(z.shape + (2,), dtype="<i2")
+    codes[..., 0] = np.clip(np.rint(dft.real), -32768, 32767)
+    codes[..., 1] = np.clip(np.rint(dft.imag), -32768, 32767)
+
+    out = bytearray()
+    for i, row in enumerate(codes):
+        header = SWEEP_HEADER.pack(SWEEP_VERSION, 1, 1, 0, mclk, start, inc, points, 15, 800)
+        out += frame_host.encode(frame_host.TYPE_SWEEP, i & 0xFFFF, i * 1000,
+                                 header + row.tobytes())
+        if i % 64 == 0:
+            out += b"Sweeping 5000-100000 Hz\n"   # console text between frames
+    return bytes(out)
+
+
+def synth_cole(n, rng):
+    """n random Cole impedances on the firmware's grid and their parameters."""
+    freq = sweep_freqs(*synth_grid())
+    w = 2 * np.pi * freq
+    truth = {
+        "rinf_ohm": rng.uniform(200, 600, n),
+        "r0_ohm": rng.uniform(900, 2000, n),
+        # Relaxation inside the sweep so all four parameters are observable
+        "tau_s": 1 / (2 * np.pi * rng.uniform(15e3, 40e3, n)),
+        "alpha": rng.uniform(0.6, 0.95, n),
+    }
+    dr = truth["r0_ohm"] - truth["rinf_ohm"]
+    jwt = 1j * w[None, :] * truth["tau_s"][:, None]
+    z = truth["rinf_ohm"][:, None] + dr[:, None] / (1 + jwt ** truth["alpha"][:, None])
+    return z, truth
+
+
+def _rate(n, seconds):
+    return f"{n / seconds:10.0f} sweeps/s  ({seconds * 1000:7.1f} ms)"
+
+
+def cmd_bench(args):
+    rng = np.random.default_rng(args.seed)
+    n = args.sweeps
+    z_true, truth = synth_cole(n, rng)
+    capture = synth_frames(z_true, args.noise, rng)
+    cal_capture = synth_frames(np.full((16, z_true.shape[1]), args.rcal + 0j), args.noise, rng)
+    print(f"bench: {n} sweeps x {z_true.shape[1]} points, {len(capture) / 1e6:.1f} MB capture, "
+          f"{args.workers} worker(s), {os.cpu_count()} cpu(s)")
+
+    start = time.perf_counter()
+    batch = decode_sweeps(read_frames(io.BytesIO(capture)))
+    print(f"decode      {_rate(n, time.perf_counter() - start)}")
+
+    cal = calibrate(decode_sweeps(read_frames(io.BytesIO(cal_capture))), args.rcal)
+    start = time.perf_counter()
+    z = impedance(batch, cal)
+    t_vec = time.perf_counter() - start
+    print(f"calibrate   {_rate(n, t_vec)}")
+
+    m = min(n, 500)
+    sub = SweepBatch(batch.freq_hz, batch.real[:m], batch.imag[:m],
+                     batch.seq[:m], batch.uptime_ms[:m], batch.temp_c[:m])
+    start = time.perf_counter()
+    z_loop = impedance_loop(sub, cal)
+    t_loop = (time.perf_counter() - start) * n / m
+    assert np.allclose(z_loop, z[:m])
+    print(f"  per-point {_rate(n, t_loop)}  x{t_loop / t_vec:.0f} slower")
+
+    for model in ("r", "rc", "cole"):
+        runs = [1] if args.workers == 1 or model != "cole" else [1, args.workers]
+        base = None
+        for workers in runs:
+            start = time.perf_counter()
+            result = fit(batch.freq_hz, z, model, workers)
+            elapsed = time.perf_counter() - start
+            note = f"  x{base / elapsed:.1f}" if base else ""
+            base = base or elapsed
+            print(f"fit {model:<4} w={workers:<2} {_rate(n, elapsed)}{note}")
+
+    # result is the last Cole fit
+    errors = {key: np.abs(result[key] / truth[key] - 1) for key in truth}
+    print("cole recovery, median / p95 relative error:")
+    for key, err in errors.items():
+        print(f"  {key:<9} {np.median(err) * 100:6.2f} % {np.percentile(err, 95) * 100:6.2f} %")
+    print(f"  fit rmse  {np.median(result['rmse']) * 100:6.2f} % of |Z|")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("fit", help="calibrate and fit a capture")
+    p.add_argument("--capture", required=True, help="raw console capture with sweep frames")
+    p.add_argument("--cal", required=True, help="capture taken on the calibration resistor")
+    p.add_argument("--rcal", type=float, required=True, help="calibration resistor, ohm")
+    p.add_argument("--model", choices=sorted(FITS), default="cole")
+    p.add_argument("--workers", type=int, default=os.cpu_count())
+    p.add_argument("--csv", help="write results here instead of stdout")
+    p.set_defaults(func=cmd_fit)
+
+    p = sub.add_parser("bench", help="time parse, calibration and fits on synthetic sweeps")
+    p.add_argument("--sweeps", type=int, default=10000)
+    p.add_argument("--workers", type=int, default=os.cpu_count())
+    p.add_argument("--noise", type=float, default=2.0, help="DFT noise, codes rms")
+    p.add_argument("--rcal", type=float, default=1000.0)
+    p.add_argument("--seed", type=int, default=1)
+    p.set_defaults(func=cmd_bench)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,197 @@
+"""Connection manager for the sensor: filtered scan, cached devices, reconnect.
+
+A plain BleakScanner.discover() waits out its whole timeout before
+anything can connect. The manager instead does an active scan filtered on
+the service UUID and connects to the first advertiser that matches.
+Known devices go to a JSON cache with their GATT handles, so the next
+start connects by address without scanning. bleak still discovers the
+services on every connect; the cached handles only let tools address
+characteristics without a UUID lookup, and are re-learned whenever the
+discovered layout differs. An unreachable cache entry is dropped and
+rescanned. A dropped link is retried with exponential backoff.
+
+The backend is any object with bleak's BleakScanner and BleakClient,
+e.g. ble_mock for runs without a radio.
+"""
+
+import asyncio
+import json
+import logging
+import os
+import random
+import time
+
+logger = logging.getLogger(__name__)
+
+CACHE_PATH = os.path.join(os.path.expanduser("~"), ".cache", "nanofab", "ble_devices.json")
+
+
+class DeviceCache:
+    """{service_uuid: {"address", "name", "handles": {char_uuid: handle}}}
+
+    A path of None keeps the cache in memory only.
+    """
+
+    def __init__(self, path=CACHE_PATH):
+        self.path = path
+        self.entries = {}
+        if path:
+            try:
+                with open(path, encoding="utf-8") as f:
+                    self.entries = json.load(f)
+            except (OSError, ValueError):
+                pass
+
+    def get(self, service_uuid):
+        return self.entries.get(service_uuid)
+
+    def put(self, service_uuid, entry):
+        self.entries[service_uuid] = entry
+        self._save()
+
+    def drop(self, service_uuid):
+        if self.entries.pop(service_uuid, None) is not None:
+            self._save()
+
+    def _save(self):
+        if not self.path:
+            return
+        os.makedirs(os.path.dirname(self.path), exist_ok=True)
+        tmp = self.path + ".tmp"
+        with open(tmp, "w", encoding="utf-8") as f:
+            json.dump(self.entries, f, indent=2)
+        os.replace(tmp, self.path)
+
+
+class ConnectionManager:
+    def __init__(self, service_uuid, backend=None, cache=None, scan_timeout=10.0,
+                 connect_timeout=5.0, min_backoff=0.2, max_backoff=8.0):
+        if backend is None:
+            import bleak as backend
+        self.backend = backend
+        self.service_uuid = service_uuid.lower()
+        self.cache = cache if cache is not None else DeviceCache()
+        self.scan_timeout = scan_timeout
+        self.connect_timeout = connect_timeout
+        self.min_backoff = min_backoff
+        self.max_backoff = max_backoff
+        self.handles = {}
+        self.client = None
+
+    def handle(self, char_uuid):
+        """Cached handle for a characteristic, or the UUID when unknown."""
+        return self.handles.get(char_uuid.lower(), char_uuid)
+
+    async def scan(self):
+        """Active scan until the first advertiser of the service UUID."""
+        loop = asyncio.get_running_loop()
+        found = loop.create_future()
+
+        def on_advertisement(device, adv):
+            if not found.done() and \
+                    self.service_uuid in (u.lower() for u in adv.service_uuids):
+                found.set_result(device)
+
+        scanner = self.backend.BleakScanner(on_advertisement,
+                                            service_uuids=[self.service_uuid],
+                                            scanning_mode="active")
+        start = time.perf_counter()
+        await scanner.start()
+        try:
+            device = await asyncio.wait_for(found, self.scan_timeout)
+        except asyncio.TimeoutError:
+            raise RuntimeError(f"no device advertising {self.service_uuid}") from None
+        finally:
+            await scanner.stop()
+
+        logger.info(f"Found {device.name} ({device.address}) in "
+                    f"{(time.perf_counter() - start) * 1000:.0f} ms")
+        return device
+
+    async def _open(self, target, disconnected):
+        client = self.backend.BleakClient(target,
+                                          disconnected_callback=lambda _: disconnected.set(),
+                                          timeout=self.connect_timeout)
+        await client.connect()
+        return client
+
+    @staticmethod
+    def _discovered(client):
+        return {c.uuid.lower(): c.handle
+                for s in client.services for c in s.characteristics}
+
+    def _learn(self, client, name):
+        handles = self._discovered(client)
+        self.handles = handles
+        self.cache.put(self.service_uuid,
+                       {"address": client.address, "name": name, "handles": handles})
+
+    async def connect(self, disconnected):
+        """Connect by cached address, falling back to a filtered scan."""
+        start = time.perf_counter()
+        entry = self.cache.get(self.service_uuid)
+        client = None
+
+        if entry:
+            try:
+                client = await self._open(entry["address"], disconnected)
+                self.handles = entry.get("handles", {})
+                name = entry.get("name")
+                # A reflashed node may have moved or reassigned its handles
+                if self._discovered(client) != self.handles:
+                    logger.info("GATT layout changed, re-learning handles")
+                    self._learn(client, name)
+            except Exception as e:  # noqa: BLE001 - any failure means rescan
+                logger.info(f"Cached {entry['address']} unreachable ({e}), scanning")
+                self.cache.drop(self.service_uuid)
+                client = None
+
+        if client is None:
+            device = await self.scan()
+            client = await self._open(device, disconnected)
+            self._learn(client, device.name)
+
+        self.client = client
+        logger.info(f"Connected to {client.address} in "
+                    f"{(time.perf_counter() - start) * 1000:.0f} ms")
+        return client
+
+    async def run(self, session):
+        """Run session(client) and reconnect it whenever the link drops.
+
+        Returns the session's result once it finishes while connected.
+        """
+        backoff = self.min_backoff
+        while True:
+            disconnected = asyncio.Event()
+            try:
+                client = await self.connect(disconnected)
+            except Exception as e:  # noqa: BLE001 - retried below
+                logger.warning(f"Connect failed: {e}")
+            else:
+                backoff = self.min_backoff
+                task = asyncio.create_task(session(client))
+                lost = asyncio.create_task(disconnected.wait())
+                done, _ = await asyncio.wait({task, lost},
+                                             return_when=asyncio.FIRST_COMPLETED)
+                lost.cancel()
+                # A GATT call can fail on a dead link before the disconnected
+                # callback fires; that is link loss too, not a session error
+                if task in done and not disconnected.is_set() and \
+                        (client.is_connected or task.cancelled() or task.exception() is None):
+                    try:
+                        return task.result()
+                    finally:
+                        await client.disconnect()
+                task.cancel()
+                (error,) = await asyncio.gather(task, return_exceptions=True)
+                if isinstance(error, Exception):
+                    logger.warning(f"Link lost ({error})")
+                else:
+                    logger.warning("Link lost")
+
+            # Jitter keeps a fleet of tools from retrying in lockstep
+            delay = backoff * random.uniform(0.8, 1.2)
+            logger.info(f"Reconnecting in {delay:.1f} s")
+            await asyncio.sleep(delay)
+            backoff = min(backoff * 2, self.max_backoff)
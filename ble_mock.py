@@ -0,0 +1,218 @@
+"""Bleak stand-in that simulates one TempSensor, for runs without a radio.
+
+  scan_devices.py --mock --start --duration 5
+
+Implements the subset of BleakScanner/BleakClient the host tools use, with
+latencies close to an nRF52 peripheral: a 100 ms advertising interval,
+connection setup, a full service discovery on every connect (as bleak
+does), and 1 Hz temperature notifications once '1' is written to
+the control characteristic. Time sync requests are answered from a node
+clock with a fixed offset, as in time_sync.c. drop_after simulates link
+loss so reconnects can be exercised; callback_delay holds back the
+disconnected callback after GATT calls already fail, the order BlueZ
+usually reports them in. Reassigning handles simulates a reflash that
+moved the attribute table.
+"""
+
+import asyncio
+import random
+import struct
+import time
+import types
+
+import time_sync_host
+
+SERVICE_UUID = "938a803f-f6b3-420b-a95a-10cc7b32b6db"
+CONTROL_CHAR_UUID = "a38a803f-f6b3-420b-a95a-10cc7b32b6db"
+TEMP_CHAR_UUID = "b38a803f-f6b3-420b-a95a-10cc7b32b6db"
+DIAG_CHAR_UUID = "c38a803f-f6b3-420b-a95a-10cc7b32b6db"
+
+# Value handles as the firmware's attribute table lays them out
+CHARACTERISTICS = {
+    CONTROL_CHAR_UUID: 0x12,
+    TEMP_CHAR_UUID: 0x14,
+    DIAG_CHAR_UUID: 0x17,
+    time_sync_host.TIME_SYNC_CHAR_UUID: 0x19,
+}
+
+
+class MockPeripheral:
+    def __init__(self, address="C0:FF:EE:00:00:01", name="TempSensor",
+                 adv_interval=0.1, connect_s=0.05, discovery_s=0.6,
+                 sample_interval=1.0, drop_after=None, callback_delay=0.0,
+                 node_offset_us=123456789):
+        self.address = address
+        self.name = name
+        self.adv_interval = adv_interval
+        self.connect_s = connect_s
+        self.discovery_s = discovery_s
+        self.sample_interval = sample_interval
+        self.drop_after = drop_after
+        self.callback_delay = callback_delay
+        self.node_offset_us = node_offset_us
+        self.handles = dict(CHARACTERISTICS)
+        self.connections = 0
+
+    def node_us(self):
+        return time.time_ns() // 1000 + self.node_offset_us
+
+    def first_advert(self):
+        """Delay until the next advertising event, random phase."""
+        return random.uniform(0.0, self.adv_interval)
+
+
+def _services(node):
+    chars = [types.SimpleNamespace(uuid=uuid, handle=handle)
+             for uuid, handle in node.handles.items()]
+    return [types.SimpleNamespace(uuid=SERVICE_UUID, characteristics=chars)]
+
+
+def make_backend(peripheral=None):
+    """Return a module-like object with BleakScanner and BleakClient."""
+    node = peripheral or MockPeripheral()
+    device = types.SimpleNamespace(address=node.address, name=node.name)
+    adv = types.SimpleNamespace(service_uuids=[SERVICE_UUID], local_name=node.name)
+
+    class BleakScanner:
+        def __init__(self, detection_callback=None, service_uuids=None, scanning_mode="active"):
+            self.callback = detection_callback
+            self.filter = [u.lower() for u in service_uuids or []]
+            self.task = None
+
+        async def _advertise(self):
+            await asyncio.sleep(node.first_advert())
+            while True:
+                if not self.filter or SERVICE_UUID in self.filter:
+                    self.callback(device, adv)
+                await asyncio.sleep(node.adv_interval)
+
+        async def start(self):
+            self.task = asyncio.create_task(self._advertise())
+
+        async def stop(self):
+            if self.task:
+                self.task.cancel()
+
+        @staticmethod
+        async def discover(timeout=5.0, **_):
+            await asyncio.sleep(timeout)
+            return [device]
+
+        @staticmethod
+        async def find_device_by_name(name, timeout=10.0, **_):
+            await asyncio.sleep(node.first_advert())
+            return device if name == node.name else None
+
+    class BleakClient:
+        def __init__(self, target, disconnected_callback=None, timeout=10.0, **_):
+            self.target = target
+            self.address = getattr(target, "address", target)
+            self.disconnected_callback = disconnected_callback
+            self.is_connected = False
+            self.services = []
+            self.mtu_size = 247
+            self.notify = {}
+            self.tasks = []
+            self.reading = False
+            self.sync_request = None
+            self.synced = False
+
+        async def __aenter__(self):
+            await self.connect()
+            return self
+
+        async def __aexit__(self, *_):
+            await self.disconnect()
+
+        async def connect(self):
+            if self.address != node.address:
+                await asyncio.sleep(5.0)
+                raise RuntimeError(f"device {self.address} not found")
+            # bleak looks an address string up with a scan of its own
+            if isinstance(self.target, str):
+                await asyncio.sleep(node.first_advert())
+            await asyncio.sleep(node.connect_s + node.discovery_s)
+            node.connections += 1
+            self.services = _services(node)
+            self.is_connected = True
+            if node.drop_after is not None:
+                self.tasks.append(asyncio.create_task(self._drop(node.drop_after)))
+
+        async def _drop(self, after):
+            await asyncio.sleep(after)
+            self._lost()
+
+        def _lost(self):
+            if not self.is_connected:
+                return
+            self.is_connected = False
+            for task in self.tasks:
+                if task is not asyncio.current_task():
+                    task.cancel()
+            if self.disconnected_callback:
+                asyncio.get_running_loop().call_later(node.callback_delay,
+                                                      self.disconnected_callback, self)
+
+        async def disconnect(self):
+            self.is_connected = False
+            for task in self.tasks:
+                task.cancel()
+
+        def _uuid(self, char):
+            if isinstance(char, int):
+                for uuid, handle in node.handles.items():
+                    if handle == char:
+                        return uuid
+                raise RuntimeError(f"Characteristic with handle 0x{char:x} was not found")
+            return char.lower()
+
+        async def start_notify(self, char, callback):
+            self.notify[self._uuid(char)] = callback
+
+        async def _readings(self):
+            raw = 37 * 256
+            while self.reading and self.is_connected:
+                raw += random.choice((-1, 0, 1))
+                centi = raw * 100 // 256
+                callback = self.notify.get(TEMP_CHAR_UUID)
+                if callback:
+                    stamp = node.node_us() - (node.node_offset_us if self.synced else 0)
+                    callback(None, bytearray(time_sync_host.SAMPLE.pack(
+                        centi // 100, centi % 100, self.synced, stamp)))
+                await asyncio.sleep(node.sample_interval)
+
+        def _check_connected(self):
+            if not self.is_connected:
+                raise RuntimeError("Not connected")
+
+        async def write_gatt_char(self, char, data, response=False):
+            self._check_connected()
+            uuid = self._uuid(char)
+            await asyncio.sleep(0.0075)  # one connection event
+            self._check_connected()
+            if uuid == CONTROL_CHAR_UUID and data[:1] in (b"0", b"1"):
+                self.reading = data[:1] == b"1"
+                if self.reading:
+                    self.tasks.append(asyncio.create_task(self._readings()))
+            elif uuid == time_sync_host.TIME_SYNC_CHAR_UUID:
+                if data[0] == time_sync_host.OP_REQUEST:
+                    _, seq, _ = time_sync_host.REQUEST.unpack(bytes(data))
+                    self.sync_request = (seq, node.node_us())
+                elif data[0] == time_sync_host.OP_ANCHOR:
+                    self.synced = True
+
+        async def read_gatt_char(self, char):
+            self._check_connected()
+            uuid = self._uuid(char)
+            await asyncio.sleep(0.0075)
+            self._check_connected()
+            if uuid == time_sync_host.TIME_SYNC_CHAR_UUID and self.sync_request:
+                seq, t2 = self.sync_request
+                return bytearray(time_sync_host.RESPONSE.pack(seq, self.synced, t2,
+                                                              node.node_us()))
+            if uuid == TEMP_CHAR_UUID:
+                return bytearray(struct.pack("<BB", 26, 32))
+            return bytearray()
+
+    return types.SimpleNamespace(BleakScanner=BleakScanner, BleakClient=BleakClient,
+                                 peripheral=node)
@@ -0,0 +1,199 @@
+/*
+ * AD5933 emulator covering the register map used by I2C/src/main.c:
+ * single-byte register writes, reads starting at a register (directly or
+ * through the 0xB0 address pointer command), temperature measurement and
+ * frequency sweeps against a fixed R1 + (R2 || C) load.
+ */
+#define DT_DRV_COMPAT adi_ad5933
+
+#include <errno.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/emul_stub_device.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/i2c_emul.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+#define AD5933_REG_BASE       0x80
+#define AD5933_REG_CTRL_HB    0x80
+#define AD5933_REG_START_FREQ 0x82
+#define AD5933_REG_FREQ_INC   0x85
+#define AD5933_REG_NUM_INC    0x88
+#define AD5933_REG_STATUS     0x8f
+#define AD5933_REG_TEMP       0x92
+#define AD5933_REG_REAL       0x94
+#define AD5933_REG_IMAG       0x96
+#define AD5933_REG_END        0x98
+
+#define AD5933_CMD_ADDR_PTR   0xb0
+
+#define AD5933_CTRL_INIT      0x1
+#define AD5933_CTRL_SWEEP     0x2
+#define AD5933_CTRL_INCREMENT 0x3
+#define AD5933_CTRL_REPEAT    0x4
+#define AD5933_CTRL_TEMP      0x9
+
+#define AD5933_STATUS_TEMP    BIT(0)
+#define AD5933_STATUS_DATA    BIT(1)
+#define AD5933_STATUS_DONE    BIT(2)
+
+/* Frequency code to Hz with the 16.776 MHz internal clock: MCLK / 4 / 2^27 */
+#define AD5933_HZ_PER_CODE    (16776000.0 / 4.0 / 134217728.0)
+
+/* Emulated load and the gain that maps its admittance to DFT codes */
+#define LOAD_R1_OHM           200.0
+#define LOAD_R2_OHM           10000.0
+#define LOAD_C_F              10e-9
+#define DFT_GAIN              1.0e8
+
+struct ad5933_emul_data {
+    uint8_t regs[AD5933_REG_END - AD5933_REG_BASE];
+    uint8_t pointer;
+    uint16_t point;
+};
+
+struct ad5933_emul_cfg {
+    uint16_t addr;
+};
+
+static uint8_t *reg_ptr(struct ad5933_emul_data *data, uint8_t reg)
+{
+    return &data->regs[reg - AD5933_REG_BASE];
+}
+
+static uint32_t get_be24(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+}
+
+static void ad5933_emul_measure(struct ad5933_emul_data *data)
+{
+    uint32_t start = get_be24(reg_ptr(data, AD5933_REG_START_FREQ));
+    uint32_t inc = get_be24(reg_ptr(data, AD5933_REG_FREQ_INC));
+    uint16_t num = sys_get_be16(reg_ptr(data, AD5933_REG_NUM_INC)) & 0x1ff;
+    double freq = (start + (double)inc * data->point) * AD5933_HZ_PER_CODE;
+    double w = 2.0 * 3.14159265358979 * freq;
+
+    /* Z = R1 + R2 / (1 + j w R2 C), the converter reports Y = 1 / Z */
+    double a = w * LOAD_R2_OHM * LOAD_C_F;
+    double den = 1.0 + a * a;
+    double z_re = LOAD_R1_OHM + LOAD_R2_OHM / den;
+    double z_im = -LOAD_R2_OHM * a / den;
+    double mag2 = z_re * z_re + z_im * z_im;
+    int16_t real = (int16_t)CLAMP(DFT_GAIN * z_re / mag2, INT16_MIN, INT16_MAX);
+    int16_t imag = (int16_t)CLAMP(-DFT_GAIN * z_im / mag2, INT16_MIN, INT16_MAX);
+
+    sys_put_be16(real, reg_ptr(data, AD5933_REG_REAL));
+    sys_put_be16(imag, reg_ptr(data, AD5933_REG_IMAG));
+
+    *reg_ptr(data, AD5933_REG_STATUS) |= AD5933_STATUS_DATA;
+    if (data->point >= num) {
+        *reg_ptr(data, AD5933_REG_STATUS) |= AD5933_STATUS_DONE;
+    }
+}
+
+static void ad5933_emul_control(struct ad5933_emul_data *data, uint8_t value)
+{
+    uint8_t *status = reg_ptr(data, AD5933_REG_STATUS);
+
+    switch (value >> 4) {
+    case AD5933_CTRL_INIT:
+        data->point = 0;
+        *status = 0;
+        break;
+    case AD5933_CTRL_SWEEP:
+        data->point = 0;
+        *status = 0;
+        ad5933_emul_measure(data);
+        break;
+    case AD5933_CTRL_INCREMENT:
+        data->point++;
+        ad5933_emul_measure(data);
+        break;
+    case AD5933_CTRL_REPEAT:
+        ad5933_emul_measure(data);
+        break;
+    case AD5933_CTRL_TEMP:
+        sys_put_be16(25 * 32, reg_ptr(data, AD5933_REG_TEMP));
+        *status |= AD5933_STATUS_TEMP;
+        break;
+    default:
+        break;
+    }
+}
+
+static int ad5933_emul_transfer(const struct emul *target, struct i2c_msg *msgs,
+                                int num_msgs, int addr)
+{
+    struct ad5933_emul_data *data = target->data;
+
+    for (int i = 0; i < num_msgs; i++) {
+        struct i2c_msg *msg = &msgs[i];
+
+        if (msg->flags & I2C_MSG_READ) {
+            for (uint32_t j = 0; j < msg->len; j++) {
+                uint8_t reg = data->pointer + j;
+
+                msg->buf[j] = (reg >= AD5933_REG_BASE && reg < AD5933_REG_END) ?
+                              *reg_ptr(data, reg) : 0;
+            }
+            /* Reading the imaginary part consumes the result */
+            if (data->pointer + msg->len > AD5933_REG_IMAG) {
+                *reg_ptr(data, AD5933_REG_STATUS) &= ~AD5933_STATUS_DATA;
+            }
+            continue;
+        }
+
+        if (msg->len == 0) {
+            continue;
+        }
+        if (msg->buf[0] == AD5933_CMD_ADDR_PTR && msg->len >= 2) {
+            data->pointer = msg->buf[1];
+            continue;
+        }
+
+        data->pointer = msg->buf[0];
+        for (uint32_t j = 1; j < msg->len; j++) {
+            uint8_t reg = msg->buf[0] + j - 1;
+
+            if (reg < AD5933_REG_BASE || reg >= AD5933_REG_STATUS) {
+                return -EIO;
+            }
+            *reg_ptr(data, reg) = msg->buf[j];
+            if (reg == AD5933_REG_CTRL_HB) {
+                ad5933_emul_control(data, msg->buf[j]);
+            }
+        }
+    }
+
+    return 0;
+}
+
+static const struct i2c_emul_api ad5933_emul_api = {
+    .transfer = ad5933_emul_transfer,
+};
+
+static int ad5933_emul_init(const struct emul *target, const struct device *parent)
+{
+    struct ad5933_emul_data *data = target->data;
+
+    ARG_UNUSED(parent);
+
+    /* Power-on default is power-down mode */
+    *reg_ptr(data, AD5933_REG_CTRL_HB) = 0xa0;
+    return 0;
+}
+
+#define AD5933_EMUL(n)                                                      \
+    static struct ad5933_emul_data ad5933_emul_data_##n;                    \
+    static const struct ad5933_emul_cfg ad5933_emul_cfg_##n = {             \
+        .addr = DT_INST_REG_ADDR(n),                                        \
+    };                                                                      \
+    EMUL_DT_INST_DEFINE(n, ad5933_emul_init, &ad5933_emul_data_##n,         \
+                        &ad5933_emul_cfg_##n, &ad5933_emul_api, NULL)
+
+DT_INST_FOREACH_STATUS_OKAY(AD5933_EMUL)
+
+/* No Zephyr driver binds this compatible, the app talks raw I2C */
+DT_INST_FOREACH_STATUS_OKAY(EMUL_STUB_DEVICE)
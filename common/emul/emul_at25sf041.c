@@ -0,0 +1,223 @@
+/*
+ * AT25SF041 SPI NOR emulator for the jedec,spi-nor driver: JEDEC ID,
+ * status, write enable, (fast) read, page program with NOR AND semantics
+ * and 4/32/64 KB and chip erase. Memory is static RAM sized from the
+ * devicetree "size" property (bits).
+ */
+#define DT_DRV_COMPAT jedec_spi_nor
+
+#include <string.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/spi.h>
+#include <zephyr/drivers/spi_emul.h>
+
+#include "emul_at25sf041.h"
+
+#define NOR_OP_WRSR   0x01
+#define NOR_OP_PP     0x02
+#define NOR_OP_READ   0x03
+#define NOR_OP_WRDI   0x04
+#define NOR_OP_RDSR   0x05
+#define NOR_OP_WREN   0x06
+#define NOR_OP_FAST   0x0b
+#define NOR_OP_SE     0x20
+#define NOR_OP_BE32K  0x52
+#define NOR_OP_CE     0x60
+#define NOR_OP_RDID   0x9f
+#define NOR_OP_RDPD   0xab
+#define NOR_OP_DPD    0xb9
+#define NOR_OP_CE2    0xc7
+#define NOR_OP_BE64K  0xd8
+
+#define NOR_STATUS_WEL BIT(1)
+#define NOR_PAGE_SIZE  256
+
+struct at25sf041_emul_data {
+    uint8_t *mem;
+    size_t size;
+    bool wel;
+    uint32_t bytes_programmed;
+    uint32_t erases;
+};
+
+struct at25sf041_emul_cfg {
+    uint8_t jedec_id[3];
+};
+
+/* Walks a spi_buf_set byte by byte; NULL buffers are skipped regions */
+struct buf_cursor {
+    const struct spi_buf_set *set;
+    size_t idx;
+    size_t off;
+};
+
+static uint8_t *cursor_next(struct buf_cursor *c)
+{
+    while (c->set && c->idx < c->set->count) {
+        const struct spi_buf *buf = &c->set->buffers[c->idx];
+
+        if (c->off < buf->len) {
+            uint8_t *byte = buf->buf ? (uint8_t *)buf->buf + c->off : NULL;
+
+            c->off++;
+            return byte;
+        }
+        c->idx++;
+        c->off = 0;
+    }
+    return NULL;
+}
+
+static size_t set_len(const struct spi_buf_set *set)
+{
+    size_t len = 0;
+
+    for (size_t i = 0; set && i < set->count; i++) {
+        len += set->buffers[i].len;
+    }
+    return len;
+}
+
+static void erase(struct at25sf041_emul_data *data, uint32_t addr, size_t block)
+{
+    if (!data->wel) {
+        return;
+    }
+    addr = (addr % data->size) & ~(block - 1);
+    memset(&data->mem[addr], 0xff, MIN(block, data->size - addr));
+    data->erases++;
+}
+
+static int at25sf041_emul_io(const struct emul *target, const struct spi_config *config,
+                             const struct spi_buf_set *tx_bufs,
+                             const struct spi_buf_set *rx_bufs)
+{
+    struct at25sf041_emul_data *data = target->data;
+    const struct at25sf041_emul_cfg *cfg = target->cfg;
+    struct buf_cursor tx = { .set = tx_bufs };
+    struct buf_cursor rx = { .set = rx_bufs };
+    size_t len = MAX(set_len(tx_bufs), set_len(rx_bufs));
+    uint8_t op = 0;
+    uint32_t addr = 0;
+
+    ARG_UNUSED(config);
+
+    for (size_t pos = 0; pos < len; pos++) {
+        uint8_t *tx_byte = cursor_next(&tx);
+        uint8_t *rx_byte = cursor_next(&rx);
+        uint8_t in = tx_byte ? *tx_byte : 0xff;
+        uint8_t out = 0xff;
+
+        if (pos == 0) {
+            op = in;
+        } else if (pos <= 3) {
+            addr = (addr << 8) | in;
+        }
+
+        switch (op) {
+        case NOR_OP_RDID:
+            if (pos >= 1 && pos <= 3) {
+                out = cfg->jedec_id[pos - 1];
+            }
+            break;
+        case NOR_OP_RDSR:
+            if (pos >= 1) {
+                out = data->wel ? NOR_STATUS_WEL : 0;
+            }
+            break;
+        case NOR_OP_READ:
+            if (pos >= 4) {
+                out = data->mem[(addr + pos - 4) % data->size];
+            }
+            break;
+        case NOR_OP_FAST:
+            if (pos >= 5) {
+                out = data->mem[(addr + pos - 5) % data->size];
+            }
+            break;
+        case NOR_OP_PP:
+            if (pos >= 4 && data->wel) {
+                /* Wraps within the page like the real part */
+                uint32_t page = (addr % data->size) & ~(NOR_PAGE_SIZE - 1);
+                uint32_t a = page | ((addr + pos - 4) & (NOR_PAGE_SIZE - 1));
+
+                data->mem[a] &= in;
+                data->bytes_programmed++;
+            }
+            break;
+        default:
+            break;
+        }
+
+        if (rx_byte) {
+            *rx_byte = out;
+        }
+    }
+
+    switch (op) {
+    case NOR_OP_WREN:
+        data->wel = true;
+        return 0;
+    case NOR_OP_SE:
+        erase(data, addr, 4 * 1024);
+        break;
+    case NOR_OP_BE32K:
+        erase(data, addr, 32 * 1024);
+        break;
+    case NOR_OP_BE64K:
+        erase(data, addr, 64 * 1024);
+        break;
+    case NOR_OP_CE:
+    case NOR_OP_CE2:
+        erase(data, 0, data->size);
+        break;
+    case NOR_OP_PP:
+    case NOR_OP_WRSR:
+    case NOR_OP_WRDI:
+        break;
+    default:
+        return 0;
+    }
+
+    /* Every program/erase/status write clears the write enable latch */
+    data->wel = false;
+    return 0;
+}
+
+void at25sf041_emul_get_stats(const struct emul *target, uint32_t *bytes_programmed,
+                              uint32_t *erases)
+{
+    const struct at25sf041_emul_data *data = target->data;
+
+    *bytes_programmed = data->bytes_programmed;
+    *erases = data->erases;
+}
+
+static const struct spi_emul_api at25sf041_emul_api = {
+    .io = at25sf041_emul_io,
+};
+
+static int at25sf041_emul_init(const struct emul *target, const struct device *parent)
+{
+    struct at25sf041_emul_data *data = target->data;
+
+    ARG_UNUSED(parent);
+
+    memset(data->mem, 0xff, data->size);
+    return 0;
+}
+
+#define AT25SF041_EMUL(n)                                                   \
+    static uint8_t at25sf041_emul_mem_##n[DT_INST_PROP(n, size) / 8];       \
+    static struct at25sf041_emul_data at25sf041_emul_data_##n = {           \
+        .mem = at25sf041_emul_mem_##n,                                      \
+        .size = sizeof(at25sf041_emul_mem_##n),                             \
+    };                                                                      \
+    static const struct at25sf041_emul_cfg at25sf041_emul_cfg_##n = {       \
+        .jedec_id = DT_INST_PROP(n, jedec_id),                              \
+    };                                                                      \
+    EMUL_DT_INST_DEFINE(n, at25sf041_emul_init, &at25sf041_emul_data_##n,   \
+                        &at25sf041_emul_cfg_##n, &at25sf041_emul_api, NULL)
+
+DT_INST_FOREACH_STATUS_OKAY(AT25SF041_EMUL)
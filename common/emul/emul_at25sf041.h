@@ -0,0 +1,11 @@
+#ifndef EMUL_AT25SF041_H_
+#define EMUL_AT25SF041_H_
+
+#include <stdint.h>
+#include <zephyr/drivers/emul.h>
+
+/* Bytes programmed and erase operations seen by the emulated flash */
+void at25sf041_emul_get_stats(const struct emul *target, uint32_t *bytes_programmed,
+                              uint32_t *erases);
+
+#endif /* EMUL_AT25SF041_H_ */
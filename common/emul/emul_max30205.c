@@ -0,0 +1,108 @@
+/*
+ * MAX30205 emulator: pointer register plus the four 16-bit registers. The
+ * temperature follows a slow triangle around 37 degC with +-1 LSB noise,
+ * which is what a body sensor log looks like to the compression stage.
+ */
+#define DT_DRV_COMPAT maxim_max30205
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/emul_stub_device.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/i2c_emul.h>
+#include <zephyr/sys/byteorder.h>
+
+#define MAX30205_REG_TEMP  0x00
+#define MAX30205_REG_COUNT 4
+
+#define TEMP_BASE_RAW   (37 * 256)
+#define TEMP_SWING_RAW  128     /* +-0.5 degC */
+#define TEMP_PERIOD     1024    /* reads per triangle */
+
+struct max30205_emul_data {
+    uint16_t regs[MAX30205_REG_COUNT];
+    uint8_t pointer;
+    uint32_t reads;
+    uint32_t noise;
+};
+
+struct max30205_emul_cfg {
+    uint16_t addr;
+};
+
+static void max30205_emul_update_temp(struct max30205_emul_data *data)
+{
+    uint32_t phase = data->reads++ % TEMP_PERIOD;
+    int32_t ramp = phase < TEMP_PERIOD / 2 ? phase : TEMP_PERIOD - phase;
+
+    /* LCG noise: -1, 0 or +1 LSB */
+    data->noise = data->noise * 1103515245U + 12345U;
+    int32_t noise = (int32_t)((data->noise >> 16) % 3) - 1;
+
+    data->regs[MAX30205_REG_TEMP] = TEMP_BASE_RAW - TEMP_SWING_RAW +
+                                    ramp * 2 * TEMP_SWING_RAW / (TEMP_PERIOD / 2) + noise;
+}
+
+static int max30205_emul_transfer(const struct emul *target, struct i2c_msg *msgs,
+                                  int num_msgs, int addr)
+{
+    struct max30205_emul_data *data = target->data;
+
+    for (int i = 0; i < num_msgs; i++) {
+        struct i2c_msg *msg = &msgs[i];
+
+        if (msg->flags & I2C_MSG_READ) {
+            if (data->pointer == MAX30205_REG_TEMP) {
+                max30205_emul_update_temp(data);
+            }
+            for (uint32_t j = 0; j < msg->len; j++) {
+                uint16_t reg = data->regs[data->pointer];
+
+                msg->buf[j] = (j % 2 == 0) ? reg >> 8 : reg & 0xff;
+            }
+            continue;
+        }
+
+        if (msg->len == 0) {
+            continue;
+        }
+        data->pointer = msg->buf[0] % MAX30205_REG_COUNT;
+        /* Configuration is one byte, THYST/TOS are two; temperature is read only */
+        if (msg->len >= 2 && data->pointer != MAX30205_REG_TEMP) {
+            data->regs[data->pointer] = msg->len >= 3 ? sys_get_be16(&msg->buf[1])
+                                                      : msg->buf[1];
+        }
+    }
+
+    return 0;
+}
+
+static const struct i2c_emul_api max30205_emul_api = {
+    .transfer = max30205_emul_transfer,
+};
+
+static int max30205_emul_init(const struct emul *target, const struct device *parent)
+{
+    struct max30205_emul_data *data = target->data;
+
+    ARG_UNUSED(parent);
+
+    data->regs[MAX30205_REG_TEMP] = TEMP_BASE_RAW;
+    data->regs[2] = 75 * 256;   /* THYST power-on default */
+    data->regs[3] = 80 * 256;   /* TOS power-on default */
+    data->noise = 1;
+    return 0;
+}
+
+#define MAX30205_EMUL(n)                                                    \
+    static struct max30205_emul_data max30205_emul_data_##n;                \
+    static const struct max30205_emul_cfg max30205_emul_cfg_##n = {         \
+        .addr = DT_INST_REG_ADDR(n),                                        \
+    };                                                                      \
+    EMUL_DT_INST_DEFINE(n, max30205_emul_init, &max30205_emul_data_##n,     \
+                        &max30205_emul_cfg_##n, &max30205_emul_api, NULL)
+
+DT_INST_FOREACH_STATUS_OKAY(MAX30205_EMUL)
+
+/* No Zephyr driver binds this compatible, the app talks raw I2C */
+DT_INST_FOREACH_STATUS_OKAY(EMUL_STUB_DEVICE)
@@ -0,0 +1,69 @@
+#include <string.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+
+#include "frame.h"
+
+size_t frame_encode(uint8_t *buf, const struct frame_header *hdr)
+{
+    size_t crc_off = FRAME_HEADER_SIZE + hdr->len;
+
+    buf[0] = FRAME_SOF;
+    buf[1] = hdr->type;
+    sys_put_le16(hdr->seq, &buf[2]);
+    sys_put_le32(hdr->offset, &buf[4]);
+    sys_put_le16(hdr->len, &buf[8]);
+    sys_put_le16(crc16_ccitt(0xffff, &buf[1], crc_off - 1), &buf[crc_off]);
+
+    return crc_off + FRAME_CRC_SIZE;
+}
+
+/* Drop the first byte and rescan for the next start of frame */
+static void resync(struct frame_parser *parser)
+{
+    uint8_t *sof = memchr(&parser->buf[1], FRAME_SOF, parser->used - 1);
+
+    if (sof) {
+        parser->used -= sof - parser->buf;
+        memmove(parser->buf, sof, parser->used);
+    } else {
+        parser->used = 0;
+    }
+}
+
+bool frame_parser_feed(struct frame_parser *parser, uint8_t byte,
+                       struct frame_header *hdr)
+{
+    size_t len;
+
+    if (parser->used == 0 && byte != FRAME_SOF) {
+        return false;
+    }
+    parser->buf[parser->used++] = byte;
+
+    while (parser->used >= FRAME_HEADER_SIZE) {
+        len = sys_get_le16(&parser->buf[8]);
+        if (FRAME_OVERHEAD + len > parser->size) {
+            resync(parser);
+            continue;
+        }
+        if (parser->used < FRAME_OVERHEAD + len) {
+            return false;
+        }
+
+        if (crc16_ccitt(0xffff, &parser->buf[1], FRAME_HEADER_SIZE - 1 + len) !=
+            sys_get_le16(&parser->buf[FRAME_HEADER_SIZE + len])) {
+            resync(parser);
+            continue;
+        }
+
+        hdr->type = parser->buf[1];
+        hdr->seq = sys_get_le16(&parser->buf[2]);
+        hdr->offset = sys_get_le32(&parser->buf[4]);
+        hdr->len = len;
+        parser->used = 0;
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,67 @@
+#ifndef FRAME_H_
+#define FRAME_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Framing for binary streams over a wired link, little endian:
+ *   u8 sof, u8 type, u16 seq, u32 offset, u16 len, payload[len], u16 crc
+ * crc is CRC-16/CCITT (init 0xffff) over type through the payload, the
+ * same CRC the flash log uses. A receiver that loses sync scans for the
+ * next sof and relies on the crc to reject false starts.
+ *
+ * Shared by the sensor app's log dump and the I2C app's sweep stream.
+ */
+
+#define FRAME_SOF         0xa5
+#define FRAME_HEADER_SIZE 10
+#define FRAME_CRC_SIZE    2
+#define FRAME_OVERHEAD    (FRAME_HEADER_SIZE + FRAME_CRC_SIZE)
+
+/* Host to node: u32 length to dump from offset, 0 for the rest of the log */
+#define FRAME_TYPE_DUMP_REQUEST 0x01
+/* Node to host: payload is log region bytes starting at offset */
+#define FRAME_TYPE_DUMP_DATA    0x81
+/* Node to host: no payload, offset is where the dump stopped */
+#define FRAME_TYPE_DUMP_END     0x82
+/*
+ * Node to host: one AD5933 sweep from the I2C app, offset is the node's
+ * uptime in ms. Payload: u8 version, u8 range, u8 pga, u8 reserved,
+ * u32 mclk_hz, u32 start_code, u32 inc_code, u16 points, u16 settling,
+ * i16 temp (1/32 degC), then points x (i16 real, i16 imag).
+ */
+#define FRAME_TYPE_SWEEP        0x83
+/* Node to host: payload is the i32 error code */
+#define FRAME_TYPE_ERROR        0x8f
+
+struct frame_header {
+    uint8_t type;
+    uint16_t seq;
+    uint32_t offset;
+    uint16_t len;
+};
+
+/*
+ * Write header and crc around a payload already placed at
+ * buf + FRAME_HEADER_SIZE. Returns the frame length.
+ */
+size_t frame_encode(uint8_t *buf, const struct frame_header *hdr);
+
+/* Incremental receiver for small frames, e.g. host requests */
+struct frame_parser {
+    uint8_t *buf;
+    size_t size;
+    size_t used;
+};
+
+/*
+ * Feed one byte. Returns true when buf holds a complete frame with a good
+ * crc; hdr is filled and the payload is at buf + FRAME_HEADER_SIZE until
+ * the next call.
+ */
+bool frame_parser_feed(struct frame_parser *parser, uint8_t byte,
+                       struct frame_header *hdr);
+
+#endif /* FRAME_H_ */
@@ -0,0 +1,411 @@
+#!/usr/bin/env python3
+"""Firmware update of the sensor over BLE with MCUmgr SMP.
+
+  dfu_host.py --name TempSensor build/I2C_BLE_MAX30205/zephyr/zephyr.signed.bin
+
+Uploads a signed MCUboot image into the secondary slot, marks it for test,
+resets the node and waits until it runs the new image (the firmware
+confirms itself once Bluetooth is up). Chunks are pipelined: up to
+--window SMP requests are in flight, bounded by the node's reported
+buffer count. After a disconnect the upload reconnects and resumes from
+the offset the node reports. Timing for each phase is printed at the end.
+
+Requires bleak.
+"""
+
+import argparse
+import asyncio
+import logging
+import struct
+import sys
+import time
+
+from bleak import BleakClient, BleakScanner
+from bleak.exc import BleakError
+
+logging.basicConfig(level=logging.INFO)
+logger = logging.getLogger(__name__)
+
+SMP_CHAR_UUID = "da2e7828-fbce-4e01-ae9e-261174997c48"
+
+# SMP header: op, flags, len, group, seq, id (big endian)
+SMP_HEADER = struct.Struct(">BBHHBB")
+OP_READ = 0
+OP_WRITE = 2
+GROUP_OS = 0
+GROUP_IMAGE = 1
+OS_RESET = 5
+OS_MCUMGR_PARAMS = 6
+IMAGE_STATE = 0
+IMAGE_UPLOAD = 1
+
+# MCUboot image header and TLV area, for the hash the node reports
+IMAGE_MAGIC = 0x96F3B83D
+IMAGE_HEADER = struct.Struct("<IIHHII")  # magic, load, hdr_size, protect_tlv, img_size, flags
+TLV_INFO = struct.Struct("<HH")
+TLV_MAGIC = 0x6907
+TLV_PROT_MAGIC = 0x6908
+TLV_SHA256 = 0x10
+
+# CBOR overhead of an upload request besides the data itself, generous
+UPLOAD_OVERHEAD = 64
+# Longest wait for any response before the link is considered stuck
+RESPONSE_TIMEOUT = 10.0
+# Wait for the tail of a rewound window, which may itself have been dropped
+DRAIN_TIMEOUT = 1.0
+
+
+# --- Minimal CBOR, enough for SMP maps ------------------------------------
+
+def _cbor_head(major, value):
+    if value < 24:
+        return bytes([major << 5 | value])
+    for info, fmt in ((24, ">B"), (25, ">H"), (26, ">I"), (27, ">Q")):
+        if value < 1 << (8 * struct.calcsize(fmt)):
+            return bytes([major << 5 | info]) + struct.pack(fmt, value)
+    raise ValueError("integer too large")
+
+
+def cbor_encode(obj):
+    if obj is True:
+        return b"\xf5"
+    if obj is False:
+        return b"\xf4"
+    if obj is None:
+        return b"\xf6"
+    if isinstance(obj, int):
+        return _cbor_head(0, obj) if obj >= 0 else _cbor_head(1, -1 - obj)
+    if isinstance(obj, (bytes, bytearray, memoryview)):
+        return _cbor_head(2, len(obj)) + bytes(obj)
+    if isinstance(obj, str):
+        data = obj.encode()
+        return _cbor_head(3, len(data)) + data
+    if isinstance(obj, (list, tuple)):
+        return _cbor_head(4, len(obj)) + b"".join(cbor_encode(v) for v in obj)
+    if isinstance(obj, dict):
+        return _cbor_head(5, len(obj)) + b"".join(
+            cbor_encode(k) + cbor_encode(v) for k, v in obj.items())
+    raise TypeError(f"cannot encode {type(obj)}")
+
+
+def cbor_decode(data, pos=0):
+    """Return (value, next position)."""
+    head = data[pos]
+    major, info = head >> 5, head & 0x1F
+    pos += 1
+    if major == 7:
+        simple = {20: False, 21: True, 22: None}
+        if info in simple:
+            return simple[info], pos
+        raise ValueError(f"unsupported simple value {info}")
+
+    indefinite = info == 31
+    if info < 24:
+        value = info
+    elif info <= 27:
+        size = 1 << (info - 24)
+        value = int.from_bytes(data[pos:pos + size], "big")
+        pos += size
+    elif indefinite and major in (4, 5):
+        value = None
+    else:
+        raise ValueError(f"unsupported additional info {info}")
+
+    if major == 0:
+        return value, pos
+    if major == 1:
+        return -1 - value, pos
+    if major in (2, 3):
+        raw = bytes(data[pos:pos + value])
+        return (raw if major == 2 else raw.decode()), pos + value
+    if major == 4:
+        items = []
+        while (data[pos] != 0xFF) if indefinite else (len(items) < value):
+            item, pos = cbor_decode(data, pos)
+            items.append(item)
+        return items, pos + (1 if indefinite else 0)
+    if major == 5:
+        result = {}
+        while (data[pos] != 0xFF) if indefinite else (len(result) < value):
+            key, pos = cbor_decode(data, pos)
+            result[key], pos = cbor_decode(data, pos)
+        return result, pos + (1 if indefinite else 0)
+    raise ValueError(f"unsupported major type {major}")
+
+
+# --- Image -----------------------------------------------------------------
+
+def image_hash(image):
+    """SHA-256 from the image's TLVs, which is how the node names images."""
+    magic, _, hdr_size, protect_size, img_size, _ = IMAGE_HEADER.unpack_from(image)
+    if magic != IMAGE_MAGIC:
+        raise ValueError("not a signed MCUboot image (use zephyr.signed.bin)")
+
+    pos = hdr_size + img_size
+    tlv_magic, _ = TLV_INFO.unpack_from(image, pos)
+    if tlv_magic == TLV_PROT_MAGIC:
+        pos += protect_size
+        tlv_magic, _ = TLV_INFO.unpack_from(image, pos)
+    if tlv_magic != TLV_MAGIC:
+        raise ValueError("image TLV area not found")
+
+    _, tlv_total = TLV_INFO.unpack_from(image, pos)
+    end = pos + tlv_total
+    pos += TLV_INFO.size
+    while pos < end:
+        tlv_type, tlv_len = TLV_INFO.unpack_from(image, pos)
+        pos += TLV_INFO.size
+        if tlv_type == TLV_SHA256:
+            return bytes(image[pos:pos + tlv_len])
+        pos += tlv_len
+    raise ValueError("image has no SHA-256 TLV")
+
+
+# --- SMP transport -----------------------------------------------------------
+
+class SmpError(RuntimeError):
+    pass
+
+
+class SmpClient:
+    """SMP over the GATT characteristic, several requests in flight."""
+
+    def __init__(self, client):
+        self.client = client
+        self.seq = 0
+        self.pending = {}
+        self.rx = bytearray()
+        # Requests larger than the MTU are split, the node reassembles them
+        self.fragment = max(client.mtu_size - 3, 20)
+
+    async def start(self):
+        await self.client.start_notify(SMP_CHAR_UUID, self._on_notify)
+
+    def _on_notify(self, _, data):
+        self.rx += data
+        while len(self.rx) >= SMP_HEADER.size:
+            _, _, length, _, seq, _ = SMP_HEADER.unpack_from(self.rx)
+            if len(self.rx) < SMP_HEADER.size + length:
+                return
+            body = bytes(self.rx[SMP_HEADER.size:SMP_HEADER.size + length])
+            del self.rx[:SMP_HEADER.size + length]
+            future = self.pending.pop(seq, None)
+            if future and not future.done():
+                future.set_result(cbor_decode(body)[0] if body else {})
+
+    async def send(self, op, group, command, payload):
+        """Queue one request, return a future for its response map."""
+        body = cbor_encode(payload)
+        seq = self.seq
+        self.seq = (self.seq + 1) & 0xFF
+        future = asyncio.get_running_loop().create_future()
+        self.pending[seq] = future
+
+        packet = SMP_HEADER.pack(op, 0, len(body), group, seq, command) + body
+        for i in range(0, len(packet), self.fragment):
+            await self.client.write_gatt_char(SMP_CHAR_UUID, packet[i:i + self.fragment],
+                                              response=False)
+        return future
+
+    def forget(self, future):
+        """Stop waiting for a response that will not come."""
+        future.cancel()
+        for seq, pending in list(self.pending.items()):
+            if pending is future:
+                del self.pending[seq]
+
+    async def request(self, op, group, command, payload, timeout=RESPONSE_TIMEOUT):
+        rsp = await asyncio.wait_for(await self.send(op, group, command, payload), timeout)
+        if rsp.get("rc", 0) != 0:
+            raise SmpError(f"group {group} command {command} failed: {rsp}")
+        return rsp
+
+
+# --- Update ------------------------------------------------------------------
+
+async def find_address(name, timeout=10.0):
+    device = await BleakScanner.find_device_by_name(name, timeout=timeout)
+    if not device:
+        raise RuntimeError(f"{name} not found")
+    return device.address
+
+
+def _node_offset(in_flight, default):
+    """Offset in the newest answered request; the node answers in order."""
+    for _, future in reversed(in_flight):
+        if future.done() and not future.cancelled():
+            rsp = future.result()
+            if rsp.get("rc", 0) != 0:
+                raise SmpError(f"upload failed: {rsp}")
+            return rsp.get("off", default)
+    return default
+
+
+async def upload_window(smp, image, sha, progress, chunk, window):
+    """Pipeline chunks from progress["off"], which tracks what the node has."""
+    in_flight = []
+    next_off = progress["off"]
+
+    while progress["off"] < len(image):
+        while next_off < len(image) and len(in_flight) < window:
+            data = image[next_off:next_off + chunk]
+            req = {"off": next_off, "data": data}
+            if next_off == 0:
+                req.update({"image": 0, "len": len(image), "sha": sha, "upgrade": False})
+            in_flight.append((next_off + len(data), await smp.send(
+                OP_WRITE, GROUP_IMAGE, IMAGE_UPLOAD, req)))
+            next_off += len(data)
+
+        done, _ = await asyncio.wait([future for _, future in in_flight],
+                                     timeout=RESPONSE_TIMEOUT,
+                                     return_when=asyncio.FIRST_COMPLETED)
+        if not done:
+            raise asyncio.TimeoutError("no upload response")
+
+        end, head = in_flight[0]
+        if head.done():
+            in_flight.pop(0)
+            progress["off"] = _node_offset([(end, head)], end)
+            if progress["off"] == end:
+                continue
+        else:
+            # A later request was answered first: the node never got the
+            # head, and its answer carries the offset it wants instead
+            progress["off"] = _node_offset(in_flight, progress["off"])
+
+        # The node is elsewhere (a dropped request or a resumed session):
+        # let what is in flight drain, then continue from its offset. It
+        # answers in order, so whatever precedes its newest answer is lost
+        # and only the requests after that one are worth waiting for
+        while True:
+            answered = [i for i, (_, future) in enumerate(in_flight) if future.done()]
+            tail = [future for _, future in in_flight[answered[-1] + 1:]]
+            if not tail:
+                break
+            done, _ = await asyncio.wait(tail, timeout=DRAIN_TIMEOUT,
+                                         return_when=asyncio.FIRST_COMPLETED)
+            if not done:
+                break
+        progress["off"] = _node_offset(in_flight, progress["off"])
+        for _, future in in_flight:
+            smp.forget(future)
+        in_flight.clear()
+        next_off = progress["off"]
+
+
+async def upload(address, image, sha, window, retries):
+    progress = {"off": 0}
+    attempts = 0
+
+    while True:
+        try:
+            async with BleakClient(address) as client:
+                smp = SmpClient(client)
+                await smp.start()
+
+                params = {}
+                try:
+                    params = await smp.request(OP_READ, GROUP_OS, OS_MCUMGR_PARAMS, {})
+                except (SmpError, asyncio.TimeoutError):
+                    logger.warning("node did not report mcumgr params, using defaults")
+                buf_size = params.get("buf_size", 384)
+                buf_count = params.get("buf_count", 1)
+                chunk = buf_size - SMP_HEADER.size - UPLOAD_OVERHEAD
+                # One buffer stays free for the node's responses
+                depth = max(1, min(window, buf_count - 1))
+                logger.info(f"MTU {client.mtu_size}, chunk {chunk} B, window {depth}" +
+                            (f", resuming at {progress['off']}" if progress["off"] else ""))
+
+                await upload_window(smp, image, sha, progress, chunk, depth)
+                return
+        except SmpError as e:
+            attempts += 1
+            if progress["off"] == 0 or attempts > retries:
+                raise
+            # The node rebooted and forgot the upload, start over
+            logger.warning(f"{e}, restarting the upload")
+            progress["off"] = 0
+        except (BleakError, asyncio.TimeoutError, EOFError) as e:
+            attempts += 1
+            if attempts > retries:
+                raise
+            logger.warning(f"upload interrupted at {progress['off']} ({e!r}), reconnecting")
+            await asyncio.sleep(min(2 ** attempts, 10))
+
+
+async def run(args):
+    with open(args.image, "rb") as f:
+        image = f.read()
+    sha = image_hash(image)
+    timings = {}
+
+    start = time.perf_counter()
+    address = args.address or await find_address(args.name)
+    timings["scan"] = time.perf_counter() - start
+
+    start = time.perf_counter()
+    await upload(address, image, sha, args.window, args.retries)
+    timings["upload"] = time.perf_counter() - start
+
+    start = time.perf_counter()
+    async with BleakClient(address) as client:
+        smp = SmpClient(client)
+        await smp.start()
+        await smp.request(OP_WRITE, GROUP_IMAGE, IMAGE_STATE, {"hash": sha, "confirm": False})
+        try:
+            await smp.request(OP_WRITE, GROUP_OS, OS_RESET, {}, timeout=2.0)
+        except (BleakError, asyncio.TimeoutError):
+            pass  # The node may drop the link before answering
+    timings["test+reset"] = time.perf_counter() - start
+
+    # MCUboot swaps the slots before the new image advertises again
+    start = time.perf_counter()
+    deadline = start + args.swap_timeout
+    while True:
+        try:
+            async with BleakClient(address, timeout=10.0) as client:
+                smp = SmpClient(client)
+                await smp.start()
+                rsp = await smp.request(OP_READ, GROUP_IMAGE, IMAGE_STATE, {})
+                break
+        except (BleakError, asyncio.TimeoutError):
+            if time.perf_counter() > deadline:
+                raise RuntimeError("node did not come back after reset")
+            await asyncio.sleep(1.0)
+    timings["swap+reconnect"] = time.perf_counter() - start
+
+    running = next((img for img in rsp.get("images", []) if img.get("active")), {})
+    if running.get("hash") != sha:
+        raise RuntimeError(f"node runs {running.get('version', '?')}, not the uploaded image")
+
+    total = sum(timings.values())
+    rate = len(image) / timings["upload"] / 1024
+    logger.info(f"Updated to {running.get('version', '?')} "
+                f"({'confirmed' if running.get('confirmed') else 'not yet confirmed'})")
+    logger.info(f"{len(image)} B image, upload {rate:.1f} KiB/s, total {total:.1f} s: " +
+                ", ".join(f"{name} {t:.1f} s" for name, t in timings.items()))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("image", help="signed image, e.g. zephyr.signed.bin")
+    parser.add_argument("--name", default="TempSensor")
+    parser.add_argument("--address", help="skip the scan")
+    parser.add_argument("--window", type=int, default=4,
+                        help="SMP requests in flight, capped by the node's buffer count")
+    parser.add_argument("--retries", type=int, default=5,
+                        help="reconnects and restarts allowed during the upload")
+    parser.add_argument("--swap-timeout", type=float, default=120.0)
+    args = parser.parse_args()
+
+    try:
+        asyncio.run(run(args))
+    except (RuntimeError, ValueError) as e:
+        logger.error(e)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
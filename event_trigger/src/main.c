@@ -10,6 +10,9 @@
 #include <zephyr/bluetooth/hci.h>
 #include <zephyr/bluetooth/uuid.h>
 #include <zephyr/bluetooth/gatt.h>
+#if defined(CONFIG_SYS_HEAP_RUNTIME_STATS)
+#include <zephyr/sys/sys_heap.h>
+#endif
 
 #define DEVICE_NAME CONFIG_BT_DEVICE_NAME
 #define DEVICE_NAME_LEN (sizeof(DEVICE_NAME) - 1)
@@ -32,6 +35,23 @@ static const struct bt_data sd[] = {
     BT_DATA(BT_DATA_NAME_COMPLETE, CONFIG_BT_DEVICE_NAME, sizeof(CONFIG_BT_DEVICE_NAME) - 1),
 };
 
+#if defined(CONFIG_SYS_HEAP_RUNTIME_STATS)
+/* Defined by the kernel when CONFIG_HEAP_MEM_POOL_SIZE > 0 */
+extern struct k_heap _system_heap;
+
+// Peak system heap use for the footprint_budget target, see overlay-budget.conf
+static void report_heap(void)
+{
+    struct sys_memory_stats stats;
+
+    if (sys_heap_runtime_stats_get(&_system_heap.heap, &stats) == 0) {
+        /* size is what sys_heap can hand out, pool what it was given */
+        printk("heap: max_allocated %zu size %zu pool %d\n", stats.max_allocated_bytes,
+               stats.allocated_bytes + stats.free_bytes, CONFIG_HEAP_MEM_POOL_SIZE);
+    }
+}
+#endif
+
 static struct bt_uuid_128 custom_service_uuid = BT_UUID_INIT_128(CUSTOM_SERVICE_UUID);
 static struct bt_uuid_128 custom_characteristic_uuid = BT_UUID_INIT_128(CUSTOM_CHARACTERISTIC_UUID);
 
@@ -132,8 +152,13 @@ int main(void)
     bt_ready();
 
     // Main loop
-    for (;;) {
+    for (uint32_t tick = 1;; tick++) {
         k_sleep(K_SECONDS(1));
+#if defined(CONFIG_SYS_HEAP_RUNTIME_STATS)
+        if (tick % 30 == 0) {
+            report_heap();
+        }
+#endif
     }
 
     return 0;
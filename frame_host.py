@@ -0,0 +1,82 @@
+"""Host side of the wired framing in common/frame.h."""
+
+import struct
+
+SOF = 0xA5
+HEADER = struct.Struct("<BBHIH")   # sof, type, seq, offset, len
+CRC = struct.Struct("<H")
+OVERHEAD = HEADER.size + CRC.size
+
+TYPE_DUMP_REQUEST = 0x01
+TYPE_DUMP_DATA = 0x81
+TYPE_DUMP_END = 0x82
+TYPE_SWEEP = 0x83
+TYPE_ERROR = 0x8F
+
+
+def _crc_table():
+    table = []
+    for byte in range(256):
+        crc = byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0x8408 if crc & 1 else crc >> 1
+        table.append(crc)
+    return table
+
+
+CRC_TABLE = _crc_table()
+
+
+def crc16_ccitt(data, crc=0xFFFF):
+    """Zephyr's crc16_ccitt(): reflected 0x1021, no final xor."""
+    for byte in data:
+        crc = (crc >> 8) ^ CRC_TABLE[(crc ^ byte) & 0xFF]
+    return crc
+
+
+def encode(ftype, seq, offset, payload=b""):
+    body = HEADER.pack(SOF, ftype, seq, offset, len(payload)) + payload
+    return body + CRC.pack(crc16_ccitt(body[1:]))
+
+
+class FrameReader:
+    """Pulls frames out of a byte stream, resyncing on bad CRC or garbage.
+
+    read(n) must return up to n bytes, or b"" on timeout.
+    """
+
+    def __init__(self, read, max_payload=4096):
+        self.read = read
+        self.max_payload = max_payload
+        self.buf = bytearray()
+        self.crc_errors = 0
+
+    def next(self):
+        """Return (type, seq, offset, payload), or None on timeout."""
+        while True:
+            start = self.buf.find(SOF)
+            if start < 0:
+                self.buf.clear()
+            elif start > 0:
+                del self.buf[:start]
+
+            if len(self.buf) >= HEADER.size:
+                _, ftype, seq, offset, length = HEADER.unpack_from(self.buf)
+                if length > self.max_payload:
+                    del self.buf[0]
+                    continue
+                end = HEADER.size + length
+                if len(self.buf) >= end + CRC.size:
+                    (crc,) = CRC.unpack_from(self.buf, end)
+                    if crc != crc16_ccitt(self.buf[1:end]):
+                        self.crc_errors += 1
+                        del self.buf[0]
+                        continue
+                    payload = bytes(self.buf[HEADER.size:end])
+                    del self.buf[:end + CRC.size]
+                    return ftype, seq, offset, payload
+
+            chunk = self.read(max(4096, HEADER.size))
+            if not chunk:
+                return None
+            self.buf += chunk
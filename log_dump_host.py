@@ -0,0 +1,217 @@
+#!/usr/bin/env python3
+"""Wired readout of the sensor's flash log, see I2C_BLE_MAX30205/src/log_dump.h.
+
+  log_dump_host.py --port /dev/ttyACM0 --out log.bin [--csv log.csv]
+
+The node must run a build with overlay-dump.conf. Any frame that is lost
+or fails its CRC triggers a new request from the first missing offset.
+--resume continues an interrupted readout into an existing --out file.
+Throughput is printed at the end, next to the UART line rate.
+
+Requires pyserial.
+"""
+
+import argparse
+import csv
+import struct
+import sys
+import time
+
+import serial
+
+import frame_host
+
+# Flash log page layout, see I2C_BLE_MAX30205/src/flash_log.h
+PAGE_SIZE = 256
+PAGE_HEADER = struct.Struct("<HBBIQHH")  # magic, format, flags, seq, base_us, count, crc
+PAGE_MAGIC = 0x4C54
+FORMAT_RAW = 1
+FORMAT_DELTA = 2
+FLAG_SYNCED = 0x01
+RAW_RECORD = struct.Struct("<Hh")
+
+REQUEST_LEN = struct.Struct("<I")
+ERROR = struct.Struct("<i")
+
+
+def read_varint(data, pos):
+    value = shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def unzigzag(v):
+    return (v >> 1) ^ -(v & 1)
+
+
+def decode_records(fmt, data, count):
+    """Return ([(delta_ms, raw)], bytes used) for one page body."""
+    rows = []
+    pos = 0
+    if fmt == FORMAT_RAW:
+        for _ in range(count):
+            rows.append(RAW_RECORD.unpack_from(data, pos))
+            pos += RAW_RECORD.size
+        return rows, pos
+
+    # FORMAT_DELTA, mirrors log_codec_decode()
+    dt = raw = 0
+    for _ in range(count):
+        head = data[pos]
+        pos += 1
+        zdt, zraw = head >> 4, head & 0xF
+        if zdt == 0xF:
+            zdt, pos = read_varint(data, pos)
+        if zraw == 0xF:
+            zraw, pos = read_varint(data, pos)
+        dt = (dt + unzigzag(zdt)) & 0xFFFF
+        raw = ((raw + unzigzag(zraw) + 0x8000) & 0xFFFF) - 0x8000
+        rows.append((dt, raw))
+    return rows, pos
+
+
+def decode_log(region):
+    """Return (samples, bad_pages); samples are (page_seq, us, synced, raw)."""
+    pages = []
+    bad = 0
+    for off in range(0, len(region) - PAGE_SIZE + 1, PAGE_SIZE):
+        page = region[off:off + PAGE_SIZE]
+        magic, fmt, flags, seq, base_us, count, crc = PAGE_HEADER.unpack_from(page)
+        if magic != PAGE_MAGIC:
+            continue
+        body = page[PAGE_HEADER.size:]
+        try:
+            if fmt not in (FORMAT_RAW, FORMAT_DELTA):
+                raise ValueError(f"unknown format {fmt}")
+            rows, used = decode_records(fmt, body, count)
+            if frame_host.crc16_ccitt(body[:used]) != crc:
+                raise ValueError("crc mismatch")
+        except (IndexError, struct.error, ValueError):
+            bad += 1
+            continue
+        pages.append((seq, base_us, flags, rows))
+
+    samples = []
+    for seq, base_us, flags, rows in sorted(pages):
+        us = base_us
+        for delta_ms, raw in rows:
+            us += delta_ms * 1000
+            samples.append((seq, us, bool(flags & FLAG_SYNCED), raw))
+    return samples, bad
+
+
+def dump(port, out, offset, length, retries):
+    reader = frame_host.FrameReader(port.read)
+    stats = {"bytes": 0, "frames": 0, "requests": 0}
+    target = offset + length if length else None
+    expected = offset
+    failures = 0
+    restarting = False
+
+    def request():
+        nonlocal restarting
+        remaining = target - expected if target is not None else 0
+        port.reset_input_buffer()
+        port.write(frame_host.encode(frame_host.TYPE_DUMP_REQUEST, 0, expected,
+                                     REQUEST_LEN.pack(remaining)))
+        stats["requests"] += 1
+        # Frames of the superseded stream may still be in flight
+        restarting = True
+
+    def resume(reason):
+        nonlocal failures
+        failures += 1
+        if failures > retries:
+            raise RuntimeError(f"{reason} at offset 0x{expected:x}, giving up")
+        print(f"{reason}, resuming at 0x{expected:x}", file=sys.stderr)
+        request()
+
+    request()
+    while True:
+        frame = reader.next()
+        if frame is None:
+            resume("timeout")
+            continue
+
+        ftype, _, off, payload = frame
+        if ftype == frame_host.TYPE_ERROR:
+            raise RuntimeError(f"node error {ERROR.unpack(payload)[0]} at 0x{off:x}")
+        if off != expected:
+            if not restarting and ftype == frame_host.TYPE_DUMP_DATA and off > expected:
+                resume("gap")
+            continue
+
+        restarting = False
+        if ftype == frame_host.TYPE_DUMP_END:
+            break
+        if ftype != frame_host.TYPE_DUMP_DATA:
+            continue
+
+        out.seek(off)
+        out.write(payload)
+        expected += len(payload)
+        stats["bytes"] += len(payload)
+        stats["frames"] += 1
+        failures = 0
+
+    stats["crc_errors"] = reader.crc_errors
+    stats["end"] = expected
+    return stats
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", required=True, help="serial device or pty")
+    parser.add_argument("--baud", type=int, default=1000000)
+    parser.add_argument("--out", default="log.bin", help="raw log region image")
+    parser.add_argument("--offset", type=lambda s: int(s, 0), default=0)
+    parser.add_argument("--length", type=lambda s: int(s, 0), default=0,
+                        help="bytes to read, 0 for the whole region")
+    parser.add_argument("--resume", action="store_true",
+                        help="continue from the size of an existing --out file")
+    parser.add_argument("--retries", type=int, default=5)
+    parser.add_argument("--csv", help="decode the log into page_seq,us,synced,raw,temp_c")
+    args = parser.parse_args()
+
+    mode = "r+b" if args.resume or args.offset else "wb"
+    try:
+        out = open(args.out, mode)
+    except FileNotFoundError:
+        out = open(args.out, "wb")
+    with out:
+        offset = args.offset
+        if args.resume:
+            offset = out.seek(0, 2)
+
+        with serial.Serial(args.port, args.baud, timeout=1.0) as port:
+            start = time.perf_counter()
+            stats = dump(port, out, offset, args.length, args.retries)
+            elapsed = time.perf_counter() - start
+
+    rate = stats["bytes"] / elapsed if elapsed else 0
+    line = args.baud / 10
+    print(f"{stats['bytes']} bytes from 0x{offset:x} to 0x{stats['end']:x} in {elapsed:.2f} s: "
+          f"{rate / 1024:.1f} KiB/s ({100 * rate / line:.0f}% of {args.baud} baud), "
+          f"{stats['frames']} frames, {stats['crc_errors']} crc errors, "
+          f"{stats['requests'] - 1} resumes")
+
+    if args.csv:
+        with open(args.out, "rb") as f:
+            samples, bad = decode_log(f.read())
+        with open(args.csv, "w", newline="") as f:
+            writer = csv.writer(f)
+            writer.writerow(["page_seq", "us", "synced", "raw", "temp_c"])
+            for seq, us, synced, raw in samples:
+                writer.writerow([seq, us, int(synced), raw, f"{raw / 256:.4f}"])
+        print(f"{len(samples)} samples decoded to {args.csv}, {bad} bad pages")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,47 @@
+"""End-to-end wired dump of the benchmark's flash log over the native_sim pty.
+
+Run by Twister for sample.nanofab.pipeline_bench.dump. The firmware logs
+CONFIG_BENCH_SAMPLES readings, prints which pty backs uart_1 and serves
+the dump; log_dump_host.py then reads the whole region through it.
+Needs pyserial and the twister_harness plugin.
+"""
+
+import io
+import logging
+import os
+import re
+import sys
+import time
+
+import serial
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), "..", ".."))
+import log_dump_host  # noqa: E402
+
+logger = logging.getLogger(__name__)
+
+PTY_RE = re.compile(r"uart_1 connected to pseudotty: (/dev/pts/\d+)")
+BENCH_SAMPLES = 2000
+
+
+def test_log_dump_throughput(dut, record_property):
+    lines = dut.readlines_until(regex=r"bench: log dump ready", timeout=60)
+    ptys = [m.group(1) for m in map(PTY_RE.search, lines) if m]
+    assert ptys, "uart_1 pty not announced"
+
+    region = io.BytesIO()
+    with serial.Serial(ptys[0], timeout=1.0) as port:
+        start = time.perf_counter()
+        stats = log_dump_host.dump(port, region, 0, 0, retries=5)
+        elapsed = time.perf_counter() - start
+
+    rate = stats["bytes"] / elapsed
+    logger.info(f"{stats['bytes']} bytes in {elapsed:.3f} s: {rate:.0f} bytes/s, "
+                f"{stats['frames']} frames, {stats['crc_errors']} crc errors, "
+                f"{stats['requests'] - 1} resumes")
+    record_property("dump_bytes_per_s", round(rate))
+
+    assert stats["crc_errors"] == 0
+    samples, bad = log_dump_host.decode_log(region.getvalue())
+    assert bad == 0
+    assert len(samples) == BENCH_SAMPLES
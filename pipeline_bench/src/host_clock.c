@@ -0,0 +1,14 @@
+/*
+ * Built into the native simulator runner against the host libc, so it can
+ * read the host's monotonic clock for the benchmark's wall time.
+ */
+#include <stdint.h>
+#include <time.h>
+
+uint64_t bench_host_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
@@ -1,44 +1,110 @@
+import argparse
 import asyncio
-from bleak import BleakScanner, BleakClient
 import logging
+import threading
+import time
+
+from ble_connection import ConnectionManager, DeviceCache
+from time_sync_host import SAMPLE, decode_sample, keep_synced
 
 logging.basicConfig(level=logging.INFO)
 logger = logging.getLogger(__name__)
 
 TARGET_UUID = "938a803f-f6b3-420b-a95a-10cc7b32b6db"
 CONTROL_CHAR_UUID = "a38a803f-f6b3-420b-a95a-10cc7b32b6db"
+TEMP_CHAR_UUID = "b38a803f-f6b3-420b-a95a-10cc7b32b6db"
+
+PROMPT = "\nEnter '1' to start readings, '0' to stop, or 'q' to quit: "
+
+
+def read_commands(loop, queue):
+    """Feed stdin lines to the event loop; survives reconnects, unlike to_thread(input)."""
+    def reader():
+        while True:
+            try:
+                line = input(PROMPT)
+            except EOFError:
+                line = "q"
+            loop.call_soon_threadsafe(queue.put_nowait, line.strip())
+            if line == "q":
+                return
+
+    threading.Thread(target=reader, daemon=True).start()
+
 
 async def main():
-    logger.info("Starting BLE scan...")
-    
-    devices = await BleakScanner.discover()
-    target_device = next((device for device in devices if device.name == "TempSensor"), None)
-    
-    if not target_device:
-        logger.error("Target device not found!")
-        return
-    
-    logger.info(f"Found target device: {target_device.name}")
-    
-    try:
-        async with BleakClient(target_device.address) as client:
-            logger.info("Connected!")
-            
+    parser = argparse.ArgumentParser(description="Connect to the TempSensor and stream readings")
+    parser.add_argument("--mock", action="store_true",
+                        help="simulated sensor instead of the radio, see ble_mock.py")
+    parser.add_argument("--start", action="store_true",
+                        help="start readings on connect instead of waiting for '1'")
+    parser.add_argument("--duration", type=float,
+                        help="quit after this many seconds instead of reading commands")
+    parser.add_argument("--no-cache", action="store_true",
+                        help="ignore and do not write the device cache")
+    args = parser.parse_args()
+
+    t_start = time.perf_counter()
+    backend = None
+    if args.mock:
+        import ble_mock
+        backend = ble_mock.make_backend()
+
+    cache = DeviceCache(path=None) if args.no_cache else None
+    manager = ConnectionManager(TARGET_UUID, backend=backend, cache=cache)
+
+    commands = asyncio.Queue()
+    if args.duration is None:
+        read_commands(asyncio.get_running_loop(), commands)
+    else:
+        asyncio.get_running_loop().call_later(args.duration, commands.put_nowait, "q")
+
+    first_sample = None
+    # The node stops notifying on disconnect, a reconnect restores them
+    readings = args.start
+
+    def on_sample(_, data):
+        nonlocal first_sample
+        # The firmware's CCC test notification is the old 2-byte format
+        if len(data) != SAMPLE.size:
+            return
+        temp_c, timestamp_us, synced = decode_sample(data)
+        if first_sample is None:
+            first_sample = time.perf_counter() - t_start
+            logger.info(f"First sample {first_sample * 1000:.0f} ms after start")
+        logger.info(f"{temp_c:.2f} C at {timestamp_us} us ({'central' if synced else 'node'} clock)")
+
+    async def session(client):
+        nonlocal readings
+        await client.start_notify(manager.handle(TEMP_CHAR_UUID), on_sample)
+        if readings:
+            await client.write_gatt_char(manager.handle(CONTROL_CHAR_UUID), b"1")
+        sync_task = asyncio.create_task(keep_synced(client))
+        try:
             while True:
-                command = input("\nEnter '1' to start readings, '0' to stop, or 'q' to quit: ")
-                
+                command = await commands.get()
                 if command.lower() == 'q':
-                    break
-                    
+                    return
                 if command in ['0', '1']:
-                    await client.write_gatt_char(CONTROL_CHAR_UUID, command.encode())
+                    readings = command == '1'
+                    await client.write_gatt_char(manager.handle(CONTROL_CHAR_UUID),
+                                                 command.encode())
                     print(f"Sent command: {command}")
                 else:
                     print("Invalid command. Use '1' to start, '0' to stop, or 'q' to quit.")
+        finally:
+            sync_task.cancel()
+            # keep_synced() logs failed rounds itself, anything else stopped it
+            (result,) = await asyncio.gather(sync_task, return_exceptions=True)
+            if isinstance(result, Exception):
+                logger.error(f"Time sync stopped: {result!r}")
 
+    try:
+        await manager.run(session)
     except Exception as e:
         logger.error(f"Error during operation: {e}")
         logger.exception("Full traceback:")
 
+
 if __name__ == "__main__":
-    asyncio.run(main())
\ No newline at end of file
+    asyncio.run(main())
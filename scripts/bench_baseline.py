@@ -0,0 +1,45 @@
+#!/usr/bin/env python3
+"""Turn a pipeline_bench console log into a baseline.conf Kconfig fragment.
+
+Usage: bench_baseline.py <console log> > pipeline_bench/baseline.conf
+
+Each "bench: <stage> ... median_ns=<n>" line becomes
+CONFIG_BENCH_BASELINE_<STAGE>_NS=<n>. The reference run itself fails with
+NO_BASELINE for every stage until then; its medians are still printed.
+Stages missing from the log (e.g. notify on native_sim) keep a zero
+baseline, which is fine because the benchmark skips them.
+"""
+
+import re
+import sys
+
+STAGES = ["acquire", "convert", "encode", "log", "notify", "impedance"]
+LINE_RE = re.compile(r"bench: (\w+) samples=\d+ median_ns=(\d+)")
+
+
+def main():
+    if len(sys.argv) != 2:
+        print(__doc__, file=sys.stderr)
+        return 2
+
+    medians = {}
+    with open(sys.argv[1], encoding="utf-8", errors="replace") as f:
+        for line in f:
+            m = LINE_RE.search(line)
+            if m:
+                medians[m.group(1)] = int(m.group(2))
+
+    if not medians:
+        print("no benchmark results in log", file=sys.stderr)
+        return 1
+
+    print("# Per-stage baselines, regenerate from a reference run with")
+    print("#   ../scripts/bench_baseline.py <console log> > baseline.conf")
+    print("# A stage that runs with a zero baseline fails the benchmark.")
+    for stage in STAGES:
+        print(f"CONFIG_BENCH_BASELINE_{stage.upper()}_NS={medians.get(stage, 0)}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,169 @@
+#!/usr/bin/env python3
+"""Check a Zephyr build against a per-subsystem RAM/ROM and stack budget.
+
+Reads the ram.json/rom.json trees written by the ram_report/rom_report
+targets, sums the size of every subsystem listed in the budget file and
+fails when a total or subsystem exceeds its limit. When a console log
+captured with CONFIG_THREAD_ANALYZER is given, the measured stack
+high-water marks are checked against the headroom in the budget too.
+If the budget has heap_headroom_pct, the log must also carry the app's
+"heap: max_allocated <n> size <n> pool <n>" lines
+(CONFIG_SYS_HEAP_RUNTIME_STATS); the heap fails when its peak eats into
+the headroom. size is the usable heap, pool the CONFIG_HEAP_MEM_POOL_SIZE
+it came from; the difference is sys_heap's own metadata, so the printed
+CONFIG_HEAP_MEM_POOL_SIZE adds it back on top of what the peak needs.
+
+Budget file format (JSON):
+
+    {
+      "subsystems": {"bt_host": ["subsys/bluetooth/host"], ...},
+      "ram": {"total": 49152, "bt_host": 12288, ...},
+      "rom": {"total": 262144, "bt_host": 81920, ...},
+      "stack_headroom_pct": 20,
+      "heap_headroom_pct": 25
+    }
+"""
+
+import argparse
+import json
+import re
+import sys
+
+# Thread analyzer line, e.g. " BT RX   : STACK: unused 412 usage 788 / 1200 (65 %); CPU: 0 %"
+STACK_RE = re.compile(r"^\s*(.+?)\s*:\s*STACK: unused \d+ usage (\d+) / (\d+) \((\d+) %\)")
+# System heap peak, e.g. "heap: max_allocated 1412 size 1960 pool 2048"
+HEAP_RE = re.compile(r"heap: max_allocated (\d+) size (\d+) pool (\d+)")
+
+
+def node_path(node):
+    return node.get("identifier") or node.get("name") or ""
+
+
+def subsystem_sizes(root, subsystems):
+    """Sum sizes per subsystem, counting each matching subtree once."""
+    sizes = {name: 0 for name in subsystems}
+    stack = [root]
+
+    while stack:
+        node = stack.pop()
+        path = node_path(node).replace("\\", "/")
+        owner = next((name for name, patterns in subsystems.items()
+                      if any(p in path for p in patterns)), None)
+        if owner is not None:
+            sizes[owner] += node.get("size", 0)
+            continue
+        stack.extend(node.get("children", []))
+
+    return sizes
+
+
+def load_report(path):
+    with open(path, encoding="utf-8") as f:
+        data = json.load(f)
+    root = data.get("symbols", data)
+    total = data.get("total_size", root.get("size", 0))
+    return root, total
+
+
+def check_memory(kind, report_path, budget, subsystems):
+    root, total = load_report(report_path)
+    limits = budget.get(kind, {})
+    sizes = subsystem_sizes(root, subsystems)
+    sizes["total"] = total
+    failures = 0
+
+    print(f"{kind.upper():4} {'subsystem':<18} {'bytes':>8} {'budget':>8} {'used':>6}")
+    for name in ["total"] + sorted(subsystems):
+        size = sizes.get(name, 0)
+        limit = limits.get(name)
+        if limit is None:
+            print(f"     {name:<18} {size:8} {'-':>8}")
+            continue
+        status = "OVER" if size > limit else ""
+        pct = 100 * size / limit if limit else (0.0 if size == 0 else float("inf"))
+        print(f"     {name:<18} {size:8} {limit:8} {pct:5.1f}% {status}")
+        failures += size > limit
+
+    return failures
+
+
+def check_stacks(log_path, headroom_pct):
+    high_water = {}
+
+    with open(log_path, encoding="utf-8", errors="replace") as f:
+        for line in f:
+            m = STACK_RE.match(line)
+            if not m:
+                continue
+            name, used, size = m.group(1), int(m.group(2)), int(m.group(3))
+            prev = high_water.get(name, (0, size))
+            high_water[name] = (max(prev[0], used), size)
+
+    if not high_water:
+        print(f"no thread analyzer output found in {log_path}")
+        return 1
+
+    failures = 0
+    limit_pct = 100 - headroom_pct
+    print(f"STACK {'thread':<20} {'used':>6} {'size':>6} (limit {limit_pct}%)")
+    for name, (used, size) in sorted(high_water.items()):
+        pct = 100 * used / size
+        status = "OVER" if pct > limit_pct else ""
+        print(f"      {name:<20} {used:6} {size:6} {pct:5.1f}% {status}")
+        failures += pct > limit_pct
+
+    return failures
+
+
+def check_heap(log_path, headroom_pct):
+    peak = size = pool = None
+
+    with open(log_path, encoding="utf-8", errors="replace") as f:
+        for line in f:
+            m = HEAP_RE.search(line)
+            if m:
+                peak = max(peak or 0, int(m.group(1)))
+                size = int(m.group(2))
+                pool = int(m.group(3))
+
+    if peak is None:
+        print(f"no heap statistics found in {log_path}")
+        return 1
+
+    # sys_heap rounds to 8-byte chunks, so the suggestion does too
+    needed = -(-peak * (100 + headroom_pct) // 100 // 8) * 8
+    status = "OVER" if needed > size else ""
+    print(f"HEAP  peak {peak} size {size} (+{headroom_pct}% headroom needs {needed}) {status}")
+    print(f"      CONFIG_HEAP_MEM_POOL_SIZE={needed + pool - size} matches the measured peak "
+          f"({pool - size} bytes of heap metadata)")
+    return int(needed > size)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--budget", required=True, help="budget JSON file")
+    parser.add_argument("--ram", required=True, help="ram.json from the ram_report target")
+    parser.add_argument("--rom", required=True, help="rom.json from the rom_report target")
+    parser.add_argument("--console-log", help="console capture with thread analyzer output")
+    args = parser.parse_args()
+
+    with open(args.budget, encoding="utf-8") as f:
+        budget = json.load(f)
+    subsystems = budget.get("subsystems", {})
+
+    failures = check_memory("ram", args.ram, budget, subsystems)
+    failures += check_memory("rom", args.rom, budget, subsystems)
+    if args.console_log:
+        failures += check_stacks(args.console_log, budget.get("stack_headroom_pct", 20))
+        if "heap_headroom_pct" in budget:
+            failures += check_heap(args.console_log, budget["heap_headroom_pct"])
+
+    if failures:
+        print(f"footprint budget exceeded ({failures} item(s))")
+        return 1
+    print("footprint budget OK")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
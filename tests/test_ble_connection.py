@@ -0,0 +1,78 @@
+"""ConnectionManager against ble_mock, no radio needed.
+
+  python -m pytest tests
+"""
+
+import asyncio
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), ".."))
+import ble_connection  # noqa: E402
+import ble_mock  # noqa: E402
+
+
+def make_manager(**peripheral):
+    backend = ble_mock.make_backend(ble_mock.MockPeripheral(adv_interval=0.02, **peripheral))
+    cache = ble_connection.DeviceCache(path=None)
+    manager = ble_connection.ConnectionManager(ble_mock.SERVICE_UUID, backend=backend,
+                                               cache=cache, min_backoff=0.05)
+    return manager, backend.peripheral
+
+
+def test_reflash_with_swapped_handles_relearns():
+    async def run():
+        manager, node = make_manager()
+        client = await manager.connect(asyncio.Event())
+        await client.disconnect()
+
+        # Same handle numbers, different owners: only a uuid -> handle
+        # comparison notices
+        handles = node.handles
+        handles[ble_mock.CONTROL_CHAR_UUID], handles[ble_mock.TEMP_CHAR_UUID] = \
+            handles[ble_mock.TEMP_CHAR_UUID], handles[ble_mock.CONTROL_CHAR_UUID]
+
+        client = await manager.connect(asyncio.Event())
+        assert manager.handle(ble_mock.CONTROL_CHAR_UUID) == handles[ble_mock.CONTROL_CHAR_UUID]
+        await client.write_gatt_char(manager.handle(ble_mock.CONTROL_CHAR_UUID), b"1")
+        assert client.reading
+        await client.disconnect()
+
+    asyncio.run(run())
+
+
+def test_failed_write_before_disconnect_callback_reconnects():
+    sessions = []
+
+    async def session(client):
+        sessions.append(client)
+        if len(sessions) > 1:
+            return "done"
+        while True:
+            await client.write_gatt_char(ble_mock.CONTROL_CHAR_UUID, b"1")
+            await asyncio.sleep(0.01)
+
+    async def run():
+        manager, node = make_manager(drop_after=0.1, callback_delay=0.2)
+        return await asyncio.wait_for(manager.run(session), 10.0), node
+
+    result, node = asyncio.run(run())
+    assert result == "done"
+    assert len(sessions) == 2
+    assert node.connections == 2
+
+
+def test_session_error_on_live_link_propagates():
+    async def session(client):
+        raise ValueError("bad reply")
+
+    async def run():
+        manager, _ = make_manager()
+        await manager.run(session)
+
+    try:
+        asyncio.run(run())
+    except ValueError:
+        pass
+    else:
+        raise AssertionError("session error was swallowed")
@@ -0,0 +1,90 @@
+import asyncio
+import itertools
+import logging
+import struct
+import time
+
+logger = logging.getLogger(__name__)
+
+TIME_SYNC_CHAR_UUID = "d38a803f-f6b3-420b-a95a-10cc7b32b6db"
+
+OP_REQUEST = 0x01
+OP_ANCHOR = 0x02
+
+# Layouts match I2C_BLE_MAX30205/src/time_sync.h
+REQUEST = struct.Struct("<BBQ")
+ANCHOR = struct.Struct("<BBQQ")
+RESPONSE = struct.Struct("<BBQQ")   # seq, synced, t2, t3
+# Temperature notification: whole, fraction, synced flag, timestamp
+SAMPLE = struct.Struct("<BBBQ")
+
+
+# Request sequence numbers keep counting across sync_clock() calls, so a
+# late response from an earlier round never matches the current one
+_seqs = itertools.count(1)
+
+
+def central_us():
+    return time.time_ns() // 1000
+
+
+async def exchange(client, seq):
+    """One request/response round. Returns (offset_us, rtt_us, node_mid_us)."""
+    t1 = central_us()
+    await client.write_gatt_char(TIME_SYNC_CHAR_UUID,
+                                 REQUEST.pack(OP_REQUEST, seq, t1), response=True)
+    data = await client.read_gatt_char(TIME_SYNC_CHAR_UUID)
+    t4 = central_us()
+
+    # t1 stays here; the node only echoes seq so the response fits one read
+    rseq, _, t2, t3 = RESPONSE.unpack(bytes(data))
+    if rseq != seq:
+        raise RuntimeError(f"stale time sync response (seq {rseq}, expected {seq})")
+
+    # Node clock minus central clock, NTP style
+    offset = ((t2 - t1) + (t3 - t4)) // 2
+    rtt = (t4 - t1) - (t3 - t2)
+    return offset, rtt, (t2 + t3) // 2
+
+
+async def sync_clock(client, rounds=8):
+    """Anchor the node to this host's clock using the lowest-RTT round."""
+    best = None
+    for _ in range(rounds):
+        try:
+            result = await exchange(client, next(_seqs) & 0xFF)
+        except RuntimeError as e:
+            logger.warning(e)
+            continue
+        if best is None or result[1] < best[1]:
+            best = result
+
+    if best is None:
+        raise RuntimeError("time sync failed: no valid exchange")
+
+    offset, rtt, node_mid = best
+    await client.write_gatt_char(TIME_SYNC_CHAR_UUID,
+                                 ANCHOR.pack(OP_ANCHOR, 0, node_mid, node_mid - offset),
+                                 response=True)
+    logger.info(f"Clock anchored: offset {offset} us, best RTT {rtt} us")
+    return offset, rtt
+
+
+async def keep_synced(client, interval=60.0, rounds=4):
+    """Re-anchor periodically so the node can estimate its drift.
+
+    A failed round is logged and tried again after the interval, so one
+    GATT error does not end time sync for the rest of the session.
+    """
+    while client.is_connected:
+        try:
+            await sync_clock(client, rounds)
+        except Exception as e:  # noqa: BLE001 - any GATT or protocol error
+            logger.warning(f"Time sync round failed: {e}")
+        await asyncio.sleep(interval)
+
+
+def decode_sample(data):
+    """Return (temperature_c, timestamp_us, synced) from a notification."""
+    whole, frac, synced, timestamp = SAMPLE.unpack(bytes(data))
+    return whole + frac / 100.0, timestamp, bool(synced)